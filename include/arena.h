@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <new>
+using namespace std;
+
+// Bump-pointer arena. Memory is carved from large blocks and only returned
+// all at once by arena_release(), so freeing a whole tree costs one call per
+// block no matter how many objects it holds. Not thread-safe: allocate from
+// one thread at a time.
+struct ArenaBlock;
+
+struct Arena {
+    ArenaBlock* head = nullptr;
+    size_t blockSize = (size_t)1 << 20; // minimum size of each new block
+    bool hugePages = false;             // back blocks with 2 MB pages where the OS allows
+
+    // Counters since the last arena_release()
+    size_t allocations = 0;   // objects handed out
+    size_t blocks = 0;        // blocks requested from the OS / heap
+    size_t hugeBlocks = 0;    // blocks mapped with MAP_HUGETLB, certainly on huge pages
+    size_t advisedBlocks = 0; // blocks only advised to use transparent huge pages
+    size_t bytesReserved = 0; // block memory obtained
+    size_t bytesUsed = 0;     // block memory handed out, including alignment padding
+};
+
+void* arena_alloc(Arena& arena, size_t bytes, size_t align = alignof(max_align_t));
+// Drop every block; everything allocated from the arena becomes invalid
+void arena_release(Arena& arena);
+
+// Construct n default-initialized T in the arena (no destructor will run)
+template <typename T>
+T* arena_new_array(Arena& arena, size_t n) {
+    T* items = (T*)arena_alloc(arena, n * sizeof(T), alignof(T));
+    for (size_t i = 0; i < n; i++) new (&items[i]) T;
+    return items;
+}
+
+// Standard allocator over an Arena, for node-based containers.
+// deallocate() is a no-op: erased entries stay in the arena until release.
+template <typename T>
+struct ArenaAllocator {
+    typedef T value_type;
+    Arena* arena;
+
+    explicit ArenaAllocator(Arena* a) : arena(a) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return (T*)arena_alloc(*arena, n * sizeof(T), alignof(T)); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
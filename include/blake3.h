@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "sha256.h"
+using namespace std;
+
+// Portable BLAKE3 (unkeyed hash mode, 32-byte output).
+// Input is split into 1 KiB chunks whose chaining values are merged on a
+// stack, so the hasher can be fed incrementally in pieces of any size.
+struct Blake3Hasher {
+    uint32_t key[8];
+    uint32_t chunkCv[8];
+    uint64_t chunkCounter;
+    uint8_t block[64];
+    size_t blockLen;
+    size_t blocksCompressed;
+    uint32_t cvStack[54][8];
+    size_t cvStackLen;
+};
+
+void blake3_init(Blake3Hasher& hasher);
+void blake3_update(Blake3Hasher& hasher, const uint8_t* data, size_t len);
+void blake3_final(const Blake3Hasher& hasher, Digest& out);
+
+void blake3_digest(const uint8_t* data, size_t len, Digest& out);
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "merkle_tree.h"
+using namespace std;
+
+// Fills out[0..count) with the digests of leaves [first, first + count)
+typedef function<bool(size_t first, size_t count, Digest* out)> LeafReader;
+
+// Merkle tree that keeps only the levels from residentLevel up in memory.
+// Leaves are grouped into aligned chunks of 2^residentLevel; a chunk's root
+// is a resident node, and the levels below it are regenerated from the leaf
+// source whenever a proof needs them. Same shape and root as MerkleTree.
+struct BoundedMerkleTree {
+    vector<Digest> nodes;        // levels residentLevel..top, level-ordered
+    vector<size_t> levelOffsets; // first node of level residentLevel + i
+    size_t residentLevel = 0;
+    size_t levelCount = 0;       // levels of the whole tree, leaves included
+    size_t leafCount = 0;
+    HashMode mode = HASH_MODE_BINARY;
+
+    // Leaf source: a dataset file with the byte offset of each chunk's
+    // first line, or a caller-supplied reader
+    string path;
+    vector<uint64_t> chunkOffsets;
+    LeafReader reader;
+
+    size_t leavesRehashed = 0; // leaves regenerated for proofs so far
+};
+
+// Lowest resident level whose nodes, together with every level above it,
+// fit in budgetBytes (the root level if nothing smaller does)
+size_t resident_level_for_budget(size_t leafCount, size_t budgetBytes);
+
+// Build from leafCount leaves delivered one chunk at a time through reader;
+// only one chunk of leaf digests is held at once
+bool build_bounded_tree(BoundedMerkleTree& tree, size_t leafCount, size_t budgetBytes, const LeafReader& reader,
+    HashMode mode = HASH_MODE_BINARY);
+// Build in one pass over an NDJSON dataset, taking the same reviews as
+// Menu::loadDataset(). The leaf count is not known up front, so adjacent
+// chunks are merged whenever the resident set outgrows the budget.
+bool build_bounded_tree_from_file(BoundedMerkleTree& tree, const string& path, size_t budgetBytes,
+    HashMode mode = HASH_MODE_BINARY);
+void free_bounded_tree(BoundedMerkleTree& tree);
+
+Digest bounded_root(const BoundedMerkleTree& tree);
+// Regenerates the leaf's chunk, also handing back the leaf digest if asked.
+// Fails if the index is out of range, the source cannot be read or it no
+// longer hashes to the resident chunk root.
+bool bounded_generate_proof(BoundedMerkleTree& tree, size_t index, ProofStep proof[], size_t& proofLen,
+    Digest* leafHash = nullptr);
+size_t bounded_tree_memory_bytes(const BoundedMerkleTree& tree);
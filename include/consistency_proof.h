@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include "merkle_tree.h"
+using namespace std;
+
+// RFC 6962 consistency proofs: show that the tree over the first n leaves
+// extends the tree over the first m, with O(log n) digests.
+// The flat tree already has the RFC 6962 shape: pairing left to right and
+// promoting an odd last node splits every range at the largest power of
+// two below its size. So each subtree the proof names is a single node of
+// the newer tree and the older tree is never rebuilt. Nodes are hashed
+// with the tree's own hash mode (no 0x00/0x01 domain prefixes).
+
+// Proof from the first oldSize leaves to the whole tree. Fails unless
+// 0 < oldSize <= tree.leafCount; oldSize == leafCount gives an empty proof.
+bool generate_consistency_proof(const MerkleTree& tree, size_t oldSize, vector<Digest>& proof);
+bool verify_consistency_proof(const Digest& oldRoot, size_t oldSize, const Digest& newRoot, size_t newSize,
+    const vector<Digest>& proof, HashMode mode = HASH_MODE_BINARY);
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "arena.h"
+#include "merkle_tree.h"
+#include "parallel.h"
+using namespace std;
+
+// Out-of-core tree build. Leaf digests are streamed to a level file; each
+// parent level is then produced by one sequential pass over its child
+// level's file, so memory stays at a few I/O buffers whatever the leaf
+// count. Pairing and odd-node promotion match build_tree(), so the root is
+// the one init_merkle_tree() gives for the same leaves.
+struct ExternalTreeBuilder {
+    string dir;
+    HashMode mode = HASH_MODE_BINARY;
+    unsigned threads = 1;
+    bool keepLevelFiles = false; // leave level_<k>.bin behind after a successful finish
+
+    // Started by init and stopped by finish: threads - 1 hashing workers
+    // beside the caller, plus one that keeps the next block read ahead
+    WorkerPool pool;
+
+    // Page-aligned I/O buffers, all from this arena
+    Arena arena;
+    Digest* leafBuffer = nullptr;
+    size_t bufferDigests = 0; // digests per buffer (even)
+    size_t buffered = 0;
+    FILE* leafFile = nullptr;
+
+    uint64_t leafCount = 0;
+    size_t levelCount = 0;
+    uint64_t bytesWritten = 0;
+    uint64_t bytesRead = 0;
+    bool failed = false; // an I/O error; finish_external_build() will fail
+};
+
+// Level file for `level` inside dir
+string external_level_path(const string& dir, size_t level);
+
+// bufferBytes is the size of each I/O buffer; building the parent levels
+// takes two and a half of them (two reads in flight, one half-size write)
+bool init_external_builder(ExternalTreeBuilder& builder, const string& dir, HashMode mode = HASH_MODE_BINARY,
+    size_t bufferBytes = (size_t)1 << 20, unsigned threads = 1);
+void external_append_leaf(ExternalTreeBuilder& builder, const Digest& leaf);
+void external_append(ExternalTreeBuilder& builder, const string& reviewID, const string& reviewText);
+// Leaves of a batch are hashed across the builder's threads
+void external_append_chunk(ExternalTreeBuilder& builder, const string* reviewIDs, const string* reviewTexts,
+    size_t n);
+
+// Build every parent level and release the buffers and threads. Fails on
+// an I/O error or when no leaves were appended; the level files are removed
+// on every path except a successful build with keepLevelFiles set.
+bool finish_external_build(ExternalTreeBuilder& builder, Digest& root);
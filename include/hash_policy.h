@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "blake3.h"
+#include "sha256.h"
+#include "xxh3.h"
+using namespace std;
+
+// Which hash function the tree uses and how internal nodes are encoded.
+// Leaves are hash(reviewID || reviewText) with the mode's function; the
+// version number is what gets saved next to a root.
+enum HashMode : uint8_t {
+    HASH_MODE_HEX_CONCAT = 1, // v1: SHA-256(hex(left) + hex(right)), the original format
+    HASH_MODE_BINARY = 2,     // v2: SHA-256(left || right) over the 64 raw bytes
+    HASH_MODE_BLAKE3 = 3,     // v3: BLAKE3(left || right)
+    HASH_MODE_XXH3_128 = 4    // v4: XXH3-128(left[0..16) || right[0..16)), not cryptographic
+};
+
+// Hash policies. Each one supplies
+//   hash(data, len, out)          digest of one message
+//   hash_concat(a, aLen, b, bLen, out)
+//                                 digest of a || b without joining them (leaves)
+//   hash_node(left, right, out)   one internal node
+//   hash_pairs(pairs, count, out) out[k] = node of pairs[2k], pairs[2k+1]
+// and is picked either at compile time (init_merkle_tree<Blake3Policy>) or
+// from a runtime HashMode through with_hash_policy().
+struct Sha256HexPolicy {
+    static constexpr HashMode mode = HASH_MODE_HEX_CONCAT;
+    static void hash(const uint8_t* data, size_t len, Digest& out) { sha256_digest(data, len, out); }
+    static void hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out);
+    static void hash_node(const Digest& left, const Digest& right, Digest& out);
+    static void hash_pairs(const Digest* pairs, size_t count, Digest* out);
+};
+
+struct Sha256Policy {
+    static constexpr HashMode mode = HASH_MODE_BINARY;
+    static void hash(const uint8_t* data, size_t len, Digest& out) { sha256_digest(data, len, out); }
+    static void hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out);
+    static void hash_node(const Digest& left, const Digest& right, Digest& out);
+    static void hash_pairs(const Digest* pairs, size_t count, Digest* out);
+};
+
+struct Blake3Policy {
+    static constexpr HashMode mode = HASH_MODE_BLAKE3;
+    static void hash(const uint8_t* data, size_t len, Digest& out) { blake3_digest(data, len, out); }
+    static void hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out);
+    static void hash_node(const Digest& left, const Digest& right, Digest& out);
+    static void hash_pairs(const Digest* pairs, size_t count, Digest* out);
+};
+
+// Digests are 16 bytes padded with zeros; only the significant half of
+// each child is fed to the parent
+struct Xxh3Policy {
+    static constexpr HashMode mode = HASH_MODE_XXH3_128;
+    static void hash(const uint8_t* data, size_t len, Digest& out) { xxh3_128_digest(data, len, out); }
+    static void hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out) {
+        xxh3_128_digest_concat(a, aLen, b, bLen, out);
+    }
+    static void hash_node(const Digest& left, const Digest& right, Digest& out);
+    static void hash_pairs(const Digest* pairs, size_t count, Digest* out);
+};
+
+// Call fn with a default-constructed policy object for mode
+// (unknown values fall back to binary SHA-256)
+template <typename Fn>
+auto with_hash_policy(HashMode mode, Fn&& fn) -> decltype(fn(Sha256Policy())) {
+    switch (mode) {
+    case HASH_MODE_HEX_CONCAT: return fn(Sha256HexPolicy());
+    case HASH_MODE_BLAKE3: return fn(Blake3Policy());
+    case HASH_MODE_XXH3_128: return fn(Xxh3Policy());
+    default: return fn(Sha256Policy());
+    }
+}
+
+const char* hash_mode_name(HashMode mode);
+// Parse a saved version number; false if it names no known mode
+bool hash_mode_from_version(unsigned version, HashMode& mode);
@@ -2,6 +2,9 @@
 #include <vector>
 #include <string>
 #include "merkle_tree.h"
+#include "merkle_stream.h"
+#include "tree_versions.h"
+#include "sparse_merkle.h"
 #include "picosha2.h"
 #include "json.hpp"
 
@@ -25,6 +28,15 @@ public:
     void simulateTampering();
     void visualizeTree();
     void runPerformanceTests();
+    void streamRoot();
+    void selectHashAlgorithm();
+    void openTreeImage();
+    void manageVersions();
+    void generateSparseProof();
+    void generateConsistencyProof();
+    void buildBoundedTree();
+    void buildExternalTree();
+    void loadAndBuild();
 
 private:
     vector<string> reviewIDs;
@@ -32,6 +44,19 @@ private:
 
     MerkleTree tree;
     bool treeBuilt;
+    unsigned buildThreads; // 0 = one per hardware thread
+    HashMode hashMode;     // algorithm for newly built trees and streams
+    MerkleStream stream;
+    VersionStore versions; // history since the last build, version 0 = that build
 
-    void visualizeProofTree(const string& leafHash, const vector<ProofStep>& proof, size_t proofLen);
+    SparseMerkleTree sparse; // keyed by reviewID, built on first use
+    bool sparseBuilt;
+
+    void startVersionHistory();
+    // Leaf `index` of the tree was built from the loaded dataset's review at
+    // that index (false for an opened image or a tree left from another file)
+    bool treeMatchesDataset(size_t index) const;
+    void printDifferences(const vector<size_t>& changed, size_t nodesCompared);
+
+    void visualizeProofTree(const Digest& leafHash, const vector<ProofStep>& proof, size_t proofLen);
 };
@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "merkle_tree.h"
+using namespace std;
+
+// Append-only Merkle root accumulator.
+// Only the right-edge frontier is kept: frontier[k] is the root of a complete
+// subtree of 2^k leaves and is valid when bit k of leafCount is set, so memory
+// is O(log n) digests. The root folds the frontier from the smallest subtree
+// upwards, which is the same tree build_tree() produces with odd-node promotion.
+struct MerkleStream {
+    Digest frontier[64];
+    uint64_t leafCount = 0;
+    HashMode mode = HASH_MODE_BINARY;
+};
+
+void init_merkle_stream(MerkleStream& stream, HashMode mode = HASH_MODE_BINARY);
+void stream_append_leaf(MerkleStream& stream, const Digest& leaf);
+void stream_append(MerkleStream& stream, const string& reviewID, const string& reviewText);
+void stream_append_chunk(MerkleStream& stream, const string* reviewIDs, const string* reviewTexts, size_t n);
+
+// Root of everything appended so far; the stream can keep growing afterwards
+Digest stream_root(const MerkleStream& stream);
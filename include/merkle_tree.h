@@ -1,30 +1,173 @@
 #pragma once
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "arena.h"
+#include "hash_policy.h"
 #include "picosha2.h"
+#include "sha256.h"
 using namespace std;
 
-struct MerkleNode {
-    string hash;
-    MerkleNode* left = nullptr;
-    MerkleNode* right = nullptr;
-    MerkleNode* parent = nullptr;
+// Digests of every supported mode are uniformly distributed in their first
+// bytes, so the first word is a fine bucket hash
+struct DigestHasher {
+    size_t operator()(const Digest& digest) const {
+        size_t h;
+        memcpy(&h, digest.data(), sizeof(h));
+        return h;
+    }
 };
 
+// Flat, level-ordered Merkle tree.
+// nodes[] holds every level back to back: level 0 (leaves) first, root last.
+// Level l has ceil(leafCount / 2^l) nodes; the children of node i on level l
+// are 2i and 2i+1 on level l-1, its sibling is i^1 and its parent is i/2.
+// An odd node at the end of a level is promoted unchanged to the next level.
+// The node array, level table and index entries all live in the tree's
+// arena, so free_merkle_tree() releases them in a handful of block frees.
 struct MerkleTree {
-    MerkleNode** leaves = nullptr;
+    typedef unordered_multimap<Digest, size_t, DigestHasher, equal_to<Digest>,
+        ArenaAllocator<pair<const Digest, size_t>>> LeafIndex;
+    typedef unordered_multimap<string, size_t, hash<string>, equal_to<string>,
+        ArenaAllocator<pair<const string, size_t>>> IdIndex;
+
+    Arena arena; // set arena.hugePages before init_merkle_tree() to use 2 MB pages
+    Digest* nodes = nullptr;
+    size_t* levelOffsets = nullptr; // index of the first node of each level
+    size_t levelCount = 0;
     size_t leafCount = 0;
-    MerkleNode* root = nullptr;
+    size_t nodeCount = 0;
+    HashMode mode = HASH_MODE_BINARY;
+
+    // Set when nodes point into a mapped tree image (see tree_image.h)
+    void* image = nullptr;
+    size_t imageBytes = 0;
+
+    // Leaf position lookups, rebuilt by init_merkle_tree(). Duplicate keys
+    // (identical ID+text, or repeated IDs) always resolve to the lowest index.
+    LeafIndex leafIndex{ LeafIndex::allocator_type(&arena) };
+    IdIndex idIndex{ IdIndex::allocator_type(&arena) };
+    vector<const string*> leafIds; // key of each leaf's idIndex entry
+
+    MerkleTree() = default;
+    // The indexes point into this tree's own arena
+    MerkleTree(const MerkleTree&) = delete;
+    MerkleTree& operator=(const MerkleTree&) = delete;
+};
+
+// Hash accounting for a batch of leaf updates
+struct UpdateStats {
+    size_t leavesUpdated = 0;
+    size_t hashesComputed = 0;   // leaf and internal hashes actually performed
+    size_t sequentialHashes = 0; // what one update_leaf() per entry would have cost
 };
 
 struct ProofStep {
-    string siblingHash;
+    Digest siblingHash;
     bool isLeft; // true = sibling on left, false = sibling on right
 };
 
-MerkleNode* build_tree(MerkleNode** nodes, size_t count);
-void init_merkle_tree(MerkleTree& tree, string* reviewIDs, string* reviewTexts, size_t n);
+// One (leaf, proof, root) triple for batch verification
+struct ProofCheck {
+    Digest leafHash;
+    const ProofStep* proof;
+    size_t proofLen;
+    const Digest* rootHash; // usually shared by the whole batch
+};
+
+// Proof for a set of leaves sharing one copy of every sibling digest.
+// The layout is fully described by leafCount and the sorted leaf indices:
+// walking the tree level by level, a known node whose sibling is also known
+// (or who has none) needs nothing, otherwise the next digest in siblings is
+// its sibling. Verifier and generator walk the same way.
+struct MultiProof {
+    size_t leafCount = 0;
+    vector<size_t> indices;   // sorted, unique leaf positions
+    vector<Digest> siblings;  // in walk order, bottom level first
+};
+
+// Hashing primitives
+// Digest of reviewID || reviewText, hashed straight from the two spans
+Digest hash_leaf(string_view reviewID, string_view reviewText, HashMode mode = HASH_MODE_BINARY);
+void hash_node(const Digest& left, const Digest& right, Digest& out, HashMode mode);
+string digest_to_hex(const Digest& digest);
+bool hex_to_digest(const string& hex, Digest& digest);
+
+// threads = 0 uses every hardware thread; the root does not depend on it
+void build_tree(MerkleTree& tree, unsigned threads = 1);
+void init_merkle_tree(MerkleTree& tree, string* reviewIDs, string* reviewTexts, size_t n,
+    HashMode mode = HASH_MODE_BINARY, unsigned threads = 1);
+// Two-step build for leaves that arrive over time. reserve_merkle_tree()
+// lays the tree out for up to `capacity` leaves, and the caller writes each
+// level in place from nodes + levelOffsets[level], promoting odd nodes as
+// build_tree() does. finish_reserved_tree() then packs the levels for the n
+// leaves actually written, n <= capacity, and indexes their IDs as
+// init_merkle_tree() does; n = 0 frees the tree.
+void reserve_merkle_tree(MerkleTree& tree, size_t capacity, HashMode mode = HASH_MODE_BINARY);
+void finish_reserved_tree(MerkleTree& tree, size_t n, string* reviewIDs);
+// Copy only the node array and level table; `to` gets no leaf IDs and no
+// lookup indexes. Point to.leafIds at IDs that outlive it to patch the copy
+// with apply_updates().
+void copy_tree_nodes(const MerkleTree& from, MerkleTree& to);
 void free_merkle_tree(MerkleTree& tree);
-string get_merkle_root(MerkleTree& tree);
+Digest get_merkle_root(const MerkleTree& tree);
+
+// Root of the same leaves under another hash mode, without building a tree
+Digest compute_root(const Digest* leaves, size_t n, HashMode mode);
+
+// Compile-time policy variants (instantiated for the four policies in
+// hash_policy.h); the runtime versions above dispatch to these
+template <typename Policy>
+void init_merkle_tree(MerkleTree& tree, string* reviewIDs, string* reviewTexts, size_t n, unsigned threads = 1);
+template <typename Policy>
+Digest compute_root(const Digest* leaves, size_t n);
+
+// Layout helpers
+size_t level_size(const MerkleTree& tree, size_t level);
+const Digest& node_hash(const MerkleTree& tree, size_t level, size_t index);
+size_t merkle_tree_memory_bytes(const MerkleTree& tree);
+
+// Replace one leaf and rehash only its path to the root, O(log n).
+// Returns false if index is out of range.
+bool update_leaf(MerkleTree& tree, size_t index, const string& newId, const string& newText);
+
+// Apply (leaf index, new review text) pairs in one pass; IDs are kept.
+// Dirty ancestors are collected level by level so each one is rehashed
+// exactly once, with each level split across `threads` workers.
+// Later entries for the same index win; out-of-range indices are skipped.
+// Needs the leaf IDs, so trees opened from an image are left unchanged.
+// A tree without a leaf index (see copy_tree_nodes()) is patched without one.
+UpdateStats apply_updates(MerkleTree& tree, const pair<size_t, string>* updates, size_t count,
+    unsigned threads = 1);
+
+// O(1) leaf position lookups
+bool find_leaf_by_hash(const MerkleTree& tree, const Digest& leafHash, size_t& index);
+bool find_leaf_by_id(const MerkleTree& tree, const string& reviewID, size_t& index);
+
+bool generate_proof(MerkleTree& tree, const Digest& leafHash, ProofStep proof[], size_t& proofLen);
+bool generate_proof_by_index(MerkleTree& tree, size_t index, ProofStep proof[], size_t& proofLen);
+// Verify many proofs across `threads` workers without heap allocation per step.
+// Bit i of resultBits (which must hold (count + 63) / 64 words) is set when
+// checks[i] verifies; returns the number that passed.
+size_t verify_proofs_batch(const ProofCheck* checks, size_t count, uint64_t* resultBits,
+    HashMode mode = HASH_MODE_BINARY, unsigned threads = 0);
+
+// Leaf indices where two trees of the same size and hash mode differ, in
+// ascending order. Only mismatching subtrees are descended into, so k
+// changed leaves cost O(k log n) node comparisons (reported in
+// nodesCompared). Either tree may be an opened image. Returns false if the
+// shapes or hash modes differ.
+bool diff_trees(const MerkleTree& a, const MerkleTree& b, vector<size_t>& differing,
+    size_t* nodesCompared = nullptr);
+
+// Multi-proofs; leafHashes passed to the verifier follow proof.indices order
+bool generate_multiproof(const MerkleTree& tree, const size_t* indices, size_t count, MultiProof& proof);
+bool verify_multiproof(const MultiProof& proof, const Digest* leafHashes, const Digest& rootHash,
+    HashMode mode = HASH_MODE_BINARY, size_t* hashesComputed = nullptr);
 
-bool generate_proof(MerkleTree& tree, const string& leafHash, ProofStep proof[], size_t& proofLen);
-bool verify_proof(const string& leafHash, ProofStep proof[], size_t proofLen, const string& rootHash);
+bool verify_proof(const Digest& leafHash, ProofStep proof[], size_t proofLen, const Digest& rootHash,
+    HashMode mode = HASH_MODE_BINARY);
@@ -0,0 +1,61 @@
+#pragma once
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+// Read-only view of a whole file: mmap'd where available, read into
+// buffer otherwise (Windows)
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+    void* mapping = nullptr;
+    string buffer;
+};
+
+bool map_file(const string& path, MappedFile& file);
+void unmap_file(MappedFile& file);
+
+// Boundaries of at most `parts` byte ranges covering the file, each one
+// starting at the beginning of a line: range k is [splits[k], splits[k+1])
+vector<size_t> split_at_lines(const MappedFile& file, size_t parts);
+
+// fn(string_view) for every line in [begin, end), newline excluded; lines
+// are found with memchr, which glibc and MSVC vectorize
+template <typename Fn>
+void for_each_line(const char* begin, const char* end, Fn&& fn) {
+    while (begin < end) {
+        const char* newline = (const char*)memchr(begin, '\n', end - begin);
+        const char* lineEnd = newline ? newline : end;
+        fn(string_view(begin, lineEnd - begin));
+        begin = newline ? newline + 1 : end;
+    }
+}
+
+struct NdjsonStats {
+    size_t lines = 0;     // lines seen, blank ones included
+    size_t records = 0;   // lines that yielded a review
+    size_t fallbacks = 0; // lines the fast scanner handed to json.hpp
+};
+
+// Extract reviewID/reviewText from one JSON line; false if either is
+// missing or not a string, or the line is not valid JSON. A flat object
+// with string, number and literal values is scanned in place, escapes
+// decoded and UTF-8 checked; anything else (nested values, escaped keys,
+// malformed input) goes through json.hpp, so the answer always matches a
+// full parse. Sets *fellBack when json.hpp was used.
+bool parse_review_line(string_view line, string& id, string& text, bool* fellBack = nullptr);
+
+// Map a dataset and call fn(id, text) for each review line in file order.
+// fn may move from its arguments. Returns false if the file cannot be opened.
+bool scan_review_file(const string& path, const function<void(string&, string&)>& fn,
+    NdjsonStats* stats = nullptr);
+
+// Load every review of a dataset, parsing line-aligned byte ranges on
+// `threads` workers (0 = all cores). Parts are concatenated in file order,
+// so the result is the same as scan_review_file() appending one by one.
+bool load_review_file(const string& path, vector<string>& reviewIDs, vector<string>& reviewTexts,
+    unsigned threads = 0, NdjsonStats* stats = nullptr);
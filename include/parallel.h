@@ -0,0 +1,40 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+// 0 means one worker per hardware thread
+unsigned resolve_thread_count(unsigned requested);
+
+// Split [0, count) into at most `threads` contiguous ranges and run
+// body(begin, end) on each; the calling thread takes the first range.
+void parallel_for(size_t count, unsigned threads, const function<void(size_t, size_t)>& body);
+
+// Threads started once and parked on a condition variable between tasks,
+// for work that would otherwise call parallel_for() many times over
+struct WorkerPool {
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake; // a task was queued or the pool is stopping
+    deque<function<void()>> tasks;
+    bool stopping = false;
+
+    ~WorkerPool();
+};
+
+// Start `workers` threads; with none, tasks run on the submitting thread
+void start_worker_pool(WorkerPool& pool, unsigned workers);
+// Run what is still queued, then join the threads
+void stop_worker_pool(WorkerPool& pool);
+// Queue a task; the future becomes ready once it has run
+future<void> pool_submit(WorkerPool& pool, function<void()> task);
+// parallel_for() over the pool's threads plus the caller. Ranges are
+// claimed as threads come free, so a worker busy with another task only
+// means the others, the caller included, take its share.
+void pool_for(WorkerPool& pool, size_t count, const function<void(size_t, size_t)>& body);
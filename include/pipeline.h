@@ -0,0 +1,109 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include "merkle_tree.h"
+using namespace std;
+
+// Bounded single-producer/single-consumer ring. A full queue makes
+// try_push() fail, which is how a slow stage holds back the one feeding it.
+// push() and pop() retry briefly and then park on a condition variable
+// until the other side makes room or delivers, so an idle stage sleeps
+// instead of burning a core.
+template <typename T>
+struct SpscQueue {
+    static const int SPIN_TRIES = 64;
+
+    vector<T> slots;
+    alignas(64) atomic<size_t> head{ 0 }; // next slot to pop, written by the consumer
+    alignas(64) atomic<size_t> tail{ 0 }; // next slot to fill, written by the producer
+    alignas(64) atomic<int> sleepers{ 0 }; // sides parked, or about to park
+    mutex lock;
+    condition_variable changed;
+
+    explicit SpscQueue(size_t capacity) : slots(capacity) {}
+
+    bool try_push(T& item) {
+        size_t t = tail.load(memory_order_relaxed);
+        if (t - head.load(memory_order_acquire) == slots.size()) return false;
+        slots[t % slots.size()] = move(item);
+        tail.store(t + 1, memory_order_release);
+        wake_sleepers();
+        return true;
+    }
+
+    bool try_pop(T& item) {
+        size_t h = head.load(memory_order_relaxed);
+        if (h == tail.load(memory_order_acquire)) return false;
+        item = move(slots[h % slots.size()]);
+        head.store(h + 1, memory_order_release);
+        wake_sleepers();
+        return true;
+    }
+
+    // Both return true if they had to wait for the other side
+    bool push(T& item) {
+        return wait_until([&] { return try_push(item); },
+            [&] { return tail.load(memory_order_relaxed) - head.load(memory_order_acquire) < slots.size(); });
+    }
+
+    bool pop(T& item) {
+        return wait_until([&] { return try_pop(item); },
+            [&] { return head.load(memory_order_relaxed) != tail.load(memory_order_acquire); });
+    }
+
+private:
+    // The fences here and in wait_until() order each side's slot update
+    // before its look at the other side: either the waker sees a sleeper,
+    // or the sleeper's check under the lock sees the update
+    void wake_sleepers() {
+        atomic_thread_fence(memory_order_seq_cst);
+        if (sleepers.load(memory_order_relaxed) == 0) return;
+        lock_guard<mutex> guard(lock);
+        changed.notify_all();
+    }
+
+    template <typename Attempt, typename Ready>
+    bool wait_until(Attempt attempt, Ready ready) {
+        if (attempt()) return false;
+        for (int i = 0; i < SPIN_TRIES; i++)
+            if (attempt()) return true;
+
+        while (!attempt()) {
+            sleepers.fetch_add(1);
+            atomic_thread_fence(memory_order_seq_cst);
+            {
+                unique_lock<mutex> guard(lock);
+                changed.wait(guard, ready);
+            }
+            sleepers.fetch_sub(1);
+        }
+        return true;
+    }
+};
+
+struct PipelineStats {
+    size_t records = 0;
+    size_t batches = 0;
+    unsigned hashWorkers = 0;
+    size_t readerStalls = 0;  // batches the reader had to wait to queue, the hash queue being full
+    size_t builderWaits = 0;  // batches the builder had to wait for, not hashed yet
+    double readMs = 0;        // reader busy time, mapping and parsing
+    double timeToRootMs = 0;
+};
+
+// Load a dataset and build its tree in one overlapped pass. A reader
+// thread parses record batches, hash workers turn each batch into its leaf
+// digests and the levels of its subtree, and the calling thread copies
+// those into the tree and folds the subtree roots above them. The tree is
+// laid out for the file's line count up front and filled in place. Batches are dealt to the workers round-robin and collected in the
+// same order, so every queue has one producer and one consumer and the
+// leaves keep their file order: reviewIDs, reviewTexts and the tree match
+// load_review_file() followed by init_merkle_tree(). threads = 0 uses every
+// core. Returns false if the file cannot be opened.
+bool load_and_build(const string& path, vector<string>& reviewIDs, vector<string>& reviewTexts,
+    MerkleTree& tree, HashMode mode = HASH_MODE_BINARY, unsigned threads = 0, PipelineStats* stats = nullptr);
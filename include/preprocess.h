@@ -15,7 +15,8 @@ struct ReviewArray {
     size_t size;
 };
 
-void load_reviews(const std::string& filename, ReviewArray& arr);
+// Parses across `threads` workers (0 = all cores); the result does not depend on it
+void load_reviews(const std::string& filename, ReviewArray& arr, unsigned threads = 0);
 void init_review_array(ReviewArray& arr, size_t initial_capacity);
 void free_review_array(ReviewArray& arr);
 
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "merkle_tree.h"
+using namespace std;
+
+// Compact wire format for an inclusion proof, little-endian:
+//   0   magic "MKP2"
+//   4   u8  hash mode (HashMode)
+//   5   u8  step count k (at most 64)
+//   6   u16 reserved, zero
+//   8   u64 leaf index
+//   16  u64 leaf count of the tree
+//   24  k raw 32-byte sibling digests, leaf level first
+// 24 + 32k bytes in all, against roughly 3x that for the hex form.
+// The side of each sibling is not stored: it follows from the leaf index
+// and leaf count (bit l of the index, no step where an odd last node is
+// promoted), so the index is bound to the fold and every proof has exactly
+// one encoding.
+static const char PROOF_MAGIC[4] = { 'M', 'K', 'P', '2' };
+static const size_t PROOF_HEADER_BYTES = 24;
+static const size_t PROOF_MAX_STEPS = 64;
+
+// Non-owning view of consecutive digests (a C++17 stand-in for span)
+struct DigestSpan {
+    const Digest* data = nullptr;
+    size_t size = 0;
+
+    const Digest& operator[](size_t i) const { return data[i]; }
+    const Digest* begin() const { return data; }
+    const Digest* end() const { return data + size; }
+};
+
+// A parsed proof; siblings point into the serialized buffer
+struct ProofView {
+    HashMode mode = HASH_MODE_BINARY;
+    uint64_t leafIndex = 0;
+    uint64_t leafCount = 0;
+    uint64_t directions = 0; // derived: bit i set = sibling i is on the left
+    DigestSpan siblings;
+};
+
+size_t serialized_proof_size(size_t proofLen);
+// Step count and sibling sides of the proof for leafIndex in a tree of
+// leafCount leaves; false if the index is out of range
+bool proof_path_shape(uint64_t leafIndex, uint64_t leafCount, size_t& steps, uint64_t& directions);
+// Appends the encoding to out; false if the proof's length or sides do not
+// match leafIndex in a tree of leafCount leaves
+bool serialize_proof(const ProofStep* proof, size_t proofLen, uint64_t leafIndex, uint64_t leafCount,
+    HashMode mode, vector<uint8_t>& out);
+
+// Checks the header, the step count against the index and leaf count, and
+// the length without copying any digest
+bool parse_proof(const uint8_t* data, size_t len, ProofView& view);
+// Folds straight from the buffer; fails on a malformed buffer or one
+// encoded for another hash mode
+bool verify_serialized_proof(const uint8_t* data, size_t len, const Digest& leafHash, const Digest& rootHash,
+    HashMode mode = HASH_MODE_BINARY);
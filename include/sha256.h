@@ -0,0 +1,52 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+using namespace std;
+
+// Raw SHA-256 output; hex is only produced at the display/save boundary
+typedef array<uint8_t, 32> Digest;
+
+// Single-message compression backend: runs blockCount 64-byte blocks
+// through the eight-word state
+struct Sha256Backend {
+    const char* name;
+    void (*compress)(uint32_t state[8], const uint8_t* blocks, size_t blockCount);
+};
+
+// Portable backend built on picosha2's block function
+const Sha256Backend& sha256_portable_backend();
+// Intel SHA extensions backend, or nullptr if the CPU lacks them
+const Sha256Backend* sha256_shani_backend();
+// Backend chosen via CPUID at startup; used by sha256_digest()
+const Sha256Backend& sha256_backend();
+
+// Single-message SHA-256 without heap allocation
+void sha256_digest(const uint8_t* data, size_t len, Digest& out);
+void sha256_digest_with(const Sha256Backend& backend, const uint8_t* data, size_t len, Digest& out);
+
+// Incremental SHA-256 for messages that arrive in pieces. Whole blocks are
+// compressed straight from the caller's buffer; only a partial block is
+// copied into the state, so nothing is allocated.
+struct Sha256State {
+    const Sha256Backend* backend;
+    uint32_t h[8];
+    uint8_t block[64];
+    size_t blockLen;
+    uint64_t total;
+};
+
+void sha256_init(Sha256State& state);
+void sha256_update(Sha256State& state, const uint8_t* data, size_t len);
+void sha256_final(Sha256State& state, Digest& out);
+
+// Multi-buffer SHA-256: hashes `count` independent messages that all have
+// the same length, 16 (AVX-512) or 8 (AVX2) at a time in SIMD lanes, with a
+// scalar fallback. The kernel is picked once from the running CPU; maxLanes
+// caps it (1 = scalar, 8 = AVX2 at most, 0 = best available, which prefers
+// SHA-NI over AVX2).
+void sha256_multi(const uint8_t* const* messages, size_t len, size_t count, Digest* digests,
+    unsigned maxLanes = 0);
+
+// Widest lane count sha256_multi() will use on this CPU
+unsigned sha256_multi_lanes();
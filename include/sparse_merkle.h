@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "merkle_tree.h"
+using namespace std;
+
+// Sparse Merkle tree over a 256-bit key space, key = SHA-256(reviewID), so a
+// review's position depends only on its ID and the root is independent of
+// insertion order.
+//
+// Digests, for a subtree at depth d (root = 0, bit d of the key picks the
+// child), with H the hash mode's function over the concatenated bytes:
+//   no leaves      EMPTY[d], with EMPTY[256] = 0 and EMPTY[d] = H(0x01, EMPTY[d+1], EMPTY[d+1])
+//   one leaf       H(0x00, key, value), whatever the depth, where value = hash_leaf(id, text)
+//   more leaves    H(0x01, left child at d+1, right child at d+1)
+// The prefixes keep a leaf from being passed off as a branch in a proof.
+// Only populated branches are stored: a branch node sits at the bit where
+// its keys first diverge, and the single-child stretch above it is folded
+// with EMPTY siblings on demand.
+static const uint32_t SPARSE_NONE = 0xffffffff;
+
+struct SparseNode {
+    Digest hash;       // leaf: H(0x00, key, value); branch: subtree digest at its split depth
+    uint32_t child[2]; // branch children
+    uint32_t leaf;     // leaf entry (for a branch: any leaf below it)
+    uint16_t depth;    // branch: split bit
+    bool isLeaf;
+};
+
+struct SparseLeaf {
+    Digest key;
+    Digest value;
+};
+
+struct SparseMerkleTree {
+    vector<SparseNode> nodes;
+    vector<SparseLeaf> leaves;
+    uint32_t root = SPARSE_NONE;
+    HashMode mode = HASH_MODE_BINARY;
+};
+
+// Path from the root to where a key's path ends: either that key's leaf
+// (membership), another single leaf sharing the key's first `depth` bits,
+// or an empty subtree (both non-membership). Siblings that are EMPTY[t]
+// are left out and marked by a clear bit in nonEmpty.
+struct SparseProof {
+    uint16_t depth = 0;
+    bool terminalLeaf = false;
+    Digest leafKey{};
+    Digest leafValue{};
+    uint8_t nonEmpty[32] = {}; // bit t-1 set: the sibling at depth t is in siblings
+    vector<Digest> siblings;   // shallowest first
+};
+
+Digest sparse_key(const string& reviewID);
+// EMPTY[0..256] for a hash mode, computed once
+const Digest* sparse_empty_digests(HashMode mode);
+
+void init_sparse_tree(SparseMerkleTree& tree, HashMode mode = HASH_MODE_BINARY);
+// Bulk build: leaves are hashed across `threads` workers and sorted by key.
+// A repeated reviewID keeps its last occurrence.
+void build_sparse_tree(SparseMerkleTree& tree, const string* reviewIDs, const string* reviewTexts, size_t n,
+    HashMode mode = HASH_MODE_BINARY, unsigned threads = 1);
+// Insert a review or replace the text of an existing ID, O(depth)
+void sparse_insert(SparseMerkleTree& tree, const string& reviewID, const string& reviewText);
+Digest sparse_root(const SparseMerkleTree& tree);
+
+// Fills proof either way; returns true if the ID is present
+bool generate_sparse_proof(const SparseMerkleTree& tree, const string& reviewID, SparseProof& proof);
+bool verify_sparse_membership(const Digest& root, const string& reviewID, const Digest& value,
+    const SparseProof& proof, HashMode mode = HASH_MODE_BINARY);
+bool verify_sparse_absence(const Digest& root, const string& reviewID, const SparseProof& proof,
+    HashMode mode = HASH_MODE_BINARY);
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include "merkle_tree.h"
+using namespace std;
+
+// On-disk tree image: a fixed header followed, at a page-aligned offset,
+// by the node array exactly as it sits in memory (level 0 first, root
+// last). Integers are stored in host byte order.
+static const char TREE_IMAGE_MAGIC[8] = { 'M', 'R', 'K', 'L', 'I', 'M', 'G', '1' };
+static const uint32_t TREE_IMAGE_VERSION = 1;
+static const uint64_t TREE_IMAGE_ALIGN = 4096;
+
+// Level-ordered flat array, odd last node promoted (the MerkleTree layout)
+static const uint8_t TREE_LAYOUT_LEVEL_ORDER = 1;
+
+struct TreeImageHeader {
+    char magic[8];
+    uint32_t version;
+    uint8_t hashMode;
+    uint8_t layout;
+    uint16_t reserved;
+    uint64_t leafCount;
+    uint64_t levelCount;
+    uint64_t nodeCount;
+    uint64_t nodesOffset;      // byte offset of nodes[0] in the file
+    uint64_t levelOffsets[64]; // index of the first node of each level
+    Digest root;
+};
+
+bool save_tree_image(const MerkleTree& tree, const string& path);
+
+// Map an image read-only (copy-on-write) and point tree.nodes into it, so
+// proofs by index are available without loading or hashing anything;
+// pages are faulted in as proofs touch them. The lookup indexes stay empty.
+// Fails if the file is missing, truncated or not a tree image.
+bool open_tree_image(const string& path, MerkleTree& tree);
+// Unmap the image behind tree.nodes; called by free_merkle_tree()
+void close_tree_image(MerkleTree& tree);
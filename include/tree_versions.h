@@ -0,0 +1,73 @@
+#pragma once
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "arena.h"
+#include "merkle_tree.h"
+using namespace std;
+
+// Persistent tree versions with structural sharing.
+// The newest version (the head) is the live tree itself: the store points
+// at its node array and copies nothing, so starting a history over a large
+// or mapped tree is free. Every older version is an overlay on top of it: a
+// node exists only where that version differs from the live tree, and a
+// null child means "the live tree's node at this position". Just before
+// commit_version() changes the live tree, the digests on the paths about to
+// change are copied once and grafted into every older version, which keeps
+// proving exactly what it did while sharing all other subtrees.
+struct VersionNode {
+    Digest hash;
+    VersionNode* child[2]; // left, right; nullptr = same as the live tree
+    uint32_t refs;         // parent pointers plus version roots
+};
+
+struct TreeVersion {
+    uint64_t id;
+    VersionNode* root; // nullptr = the live tree itself
+    Digest rootHash;
+};
+
+struct VersionStore {
+    // The live tree's layout, not owned; valid until that tree is freed
+    const Digest* baseNodes = nullptr;
+    const size_t* levelOffsets = nullptr;
+    size_t levelCount = 0;
+    size_t leafCount = 0;
+    HashMode mode = HASH_MODE_BINARY;
+
+    vector<TreeVersion> versions; // live versions, oldest first
+    uint64_t nextId = 0;
+    uint64_t headId = 0;          // the version that is the live tree
+
+    // Overlay nodes come from the arena; reclaimed ones are reused first
+    Arena arena;
+    VersionNode* freeList = nullptr;
+    size_t liveNodes = 0;
+};
+
+// Start a history whose version 0 is the tree as it is now. The tree must
+// only change through commit_version() from here on; rebuilding or freeing
+// it needs a new init_version_store().
+void init_version_store(VersionStore& store, const MerkleTree& tree);
+void free_version_store(VersionStore& store);
+
+const TreeVersion* find_version(const VersionStore& store, uint64_t id);
+const TreeVersion* latest_version(const VersionStore& store);
+
+// Apply (leaf index, new review text) pairs to the live tree with
+// apply_updates() and record the result as the new head. Fails, changing
+// nothing, if the store belongs to another tree, the tree has no leaf IDs
+// (an opened image) or an index is out of range.
+bool commit_version(VersionStore& store, MerkleTree& tree, const pair<size_t, string>* updates, size_t count,
+    uint64_t& newId, unsigned threads = 1);
+
+// Drop a version; overlay nodes no other version shares are reclaimed.
+// The head cannot be released, since it is the live tree.
+bool release_version(VersionStore& store, uint64_t id);
+
+Digest version_leaf(const VersionStore& store, uint64_t id, size_t index);
+bool version_generate_proof(const VersionStore& store, uint64_t id, size_t index, ProofStep proof[],
+    size_t& proofLen);
+
+// Overlay nodes and version records; the live tree is not counted
+size_t version_store_memory_bytes(const VersionStore& store);
@@ -0,0 +1,13 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "sha256.h"
+using namespace std;
+
+// XXH3-128 with seed 0 and the default secret; non-cryptographic, meant
+// only for fast change detection on trusted data. The digest holds the
+// canonical big-endian form (high 64 bits, then low 64 bits) in its first
+// 16 bytes and zeros after.
+void xxh3_128_digest(const uint8_t* data, size_t len, Digest& out);
+// Digest of a followed by b, without joining them on the heap
+void xxh3_128_digest_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out);
@@ -0,0 +1,98 @@
+#include "arena.h"
+#include <new>
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+static const size_t HUGE_PAGE_SIZE = (size_t)2 << 20;
+
+// Header at the start of every block
+struct ArenaBlock {
+    ArenaBlock* next;
+    size_t size;   // usable bytes after the header
+    size_t used;
+    size_t mapped; // mmap length, 0 if the block came from operator new
+};
+
+static size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+// Huge-page blocks are mmap'd: explicit MAP_HUGETLB pages first, then
+// transparent huge pages as a hint. Only MAP_HUGETLB guarantees huge pages;
+// an accepted hint is counted separately, as the kernel may still use 4 KB. Elsewhere, or if mapping fails, the
+// block comes from the normal heap.
+static ArenaBlock* new_block(Arena& arena, size_t minBytes) {
+    size_t total = align_up(sizeof(ArenaBlock) + minBytes, 64);
+    if (total < arena.blockSize) total = arena.blockSize;
+
+    void* memory = nullptr;
+    size_t mapped = 0;
+#if defined(__linux__)
+    if (arena.hugePages) {
+        total = align_up(total, HUGE_PAGE_SIZE);
+        memory = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (memory != MAP_FAILED) {
+            arena.hugeBlocks++;
+        }
+        else {
+            memory = mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (memory == MAP_FAILED) memory = nullptr;
+#ifdef MADV_HUGEPAGE
+            else if (madvise(memory, total, MADV_HUGEPAGE) == 0) arena.advisedBlocks++;
+#endif
+        }
+        if (memory) mapped = total;
+    }
+#endif
+    if (!memory) memory = ::operator new(total);
+
+    ArenaBlock* block = (ArenaBlock*)memory;
+    block->next = arena.head;
+    block->size = total - sizeof(ArenaBlock);
+    block->used = 0;
+    block->mapped = mapped;
+    arena.head = block;
+    arena.blocks++;
+    arena.bytesReserved += total;
+    return block;
+}
+
+void* arena_alloc(Arena& arena, size_t bytes, size_t align) {
+    ArenaBlock* block = arena.head;
+    size_t offset = 0;
+    if (block) {
+        // Align the absolute address, since block payloads are only 16-byte aligned
+        uintptr_t base = (uintptr_t)(block + 1);
+        offset = align_up(base + block->used, align) - base;
+    }
+    if (!block || offset + bytes > block->size) {
+        block = new_block(arena, bytes + align);
+        uintptr_t base = (uintptr_t)(block + 1);
+        offset = align_up(base, align) - base;
+    }
+
+    arena.bytesUsed += offset + bytes - block->used;
+    block->used = offset + bytes;
+    arena.allocations++;
+    return (uint8_t*)(block + 1) + offset;
+}
+
+void arena_release(Arena& arena) {
+    for (ArenaBlock* block = arena.head; block;) {
+        ArenaBlock* next = block->next;
+#if defined(__linux__)
+        if (block->mapped) munmap(block, block->mapped);
+        else
+#endif
+            ::operator delete(block);
+        block = next;
+    }
+    arena.head = nullptr;
+    arena.allocations = 0;
+    arena.blocks = 0;
+    arena.hugeBlocks = 0;
+    arena.advisedBlocks = 0;
+    arena.bytesReserved = 0;
+    arena.bytesUsed = 0;
+}
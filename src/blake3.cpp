@@ -0,0 +1,184 @@
+#include "blake3.h"
+#include <algorithm>
+#include <cstring>
+
+static const uint32_t IV[8] = {
+    0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+};
+
+// Message word order for each of the 7 rounds (the permutation applied repeatedly)
+static const uint8_t MSG_SCHEDULE[7][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 2, 6, 3, 10, 7, 0, 4, 13, 1, 11, 12, 5, 9, 14, 15, 8 },
+    { 3, 4, 10, 12, 13, 2, 7, 14, 6, 5, 9, 0, 11, 15, 8, 1 },
+    { 10, 7, 12, 9, 14, 3, 13, 15, 4, 0, 11, 2, 5, 8, 1, 6 },
+    { 12, 13, 9, 11, 15, 10, 14, 8, 7, 2, 5, 3, 0, 1, 6, 4 },
+    { 9, 14, 11, 5, 8, 12, 15, 1, 13, 3, 0, 10, 2, 6, 4, 7 },
+    { 11, 15, 5, 0, 1, 9, 8, 6, 14, 10, 2, 12, 3, 4, 7, 13 },
+};
+
+static const size_t CHUNK_LEN = 1024;
+static const uint32_t CHUNK_START = 1 << 0;
+static const uint32_t CHUNK_END = 1 << 1;
+static const uint32_t PARENT = 1 << 2;
+static const uint32_t ROOT = 1 << 3;
+
+static inline uint32_t rotr32(uint32_t x, int n) {
+    return (x >> n) | (x << (32 - n));
+}
+
+static inline uint32_t load_le32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void g(uint32_t s[16], size_t a, size_t b, size_t c, size_t d, uint32_t mx, uint32_t my) {
+    s[a] = s[a] + s[b] + mx;
+    s[d] = rotr32(s[d] ^ s[a], 16);
+    s[c] = s[c] + s[d];
+    s[b] = rotr32(s[b] ^ s[c], 12);
+    s[a] = s[a] + s[b] + my;
+    s[d] = rotr32(s[d] ^ s[a], 8);
+    s[c] = s[c] + s[d];
+    s[b] = rotr32(s[b] ^ s[c], 7);
+}
+
+// Full 16-word compression output; the first 8 words are the new chaining value
+static void compress(const uint32_t cv[8], const uint8_t block[64], uint64_t counter, uint32_t blockLen,
+    uint32_t flags, uint32_t out[16]) {
+    uint32_t m[16];
+    for (size_t i = 0; i < 16; i++) m[i] = load_le32(block + 4 * i);
+
+    uint32_t s[16] = {
+        cv[0], cv[1], cv[2], cv[3], cv[4], cv[5], cv[6], cv[7],
+        IV[0], IV[1], IV[2], IV[3],
+        (uint32_t)counter, (uint32_t)(counter >> 32), blockLen, flags
+    };
+
+    // Fully unrolled so the schedule indexes become constants
+#pragma GCC unroll 7
+    for (int round = 0; round < 7; round++) {
+        const uint8_t* w = MSG_SCHEDULE[round];
+        g(s, 0, 4, 8, 12, m[w[0]], m[w[1]]);
+        g(s, 1, 5, 9, 13, m[w[2]], m[w[3]]);
+        g(s, 2, 6, 10, 14, m[w[4]], m[w[5]]);
+        g(s, 3, 7, 11, 15, m[w[6]], m[w[7]]);
+        g(s, 0, 5, 10, 15, m[w[8]], m[w[9]]);
+        g(s, 1, 6, 11, 12, m[w[10]], m[w[11]]);
+        g(s, 2, 7, 8, 13, m[w[12]], m[w[13]]);
+        g(s, 3, 4, 9, 14, m[w[14]], m[w[15]]);
+    }
+
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = s[i] ^ s[i + 8];
+        out[i + 8] = s[i + 8] ^ cv[i];
+    }
+}
+
+static void parent_cv(const uint32_t key[8], const uint32_t left[8], const uint32_t right[8], uint32_t flags,
+    uint32_t out[8]) {
+    uint8_t block[64];
+    for (size_t i = 0; i < 8; i++) {
+        for (size_t b = 0; b < 4; b++) {
+            block[4 * i + b] = (uint8_t)(left[i] >> (8 * b));
+            block[32 + 4 * i + b] = (uint8_t)(right[i] >> (8 * b));
+        }
+    }
+    uint32_t full[16];
+    compress(key, block, 0, 64, PARENT | flags, full);
+    memcpy(out, full, 8 * sizeof(uint32_t));
+}
+
+static void start_chunk(Blake3Hasher& hasher, uint64_t counter) {
+    memcpy(hasher.chunkCv, hasher.key, sizeof(hasher.chunkCv));
+    hasher.chunkCounter = counter;
+    hasher.blockLen = 0;
+    hasher.blocksCompressed = 0;
+}
+
+static uint32_t chunk_start_flag(const Blake3Hasher& hasher) {
+    return hasher.blocksCompressed == 0 ? CHUNK_START : 0;
+}
+
+void blake3_init(Blake3Hasher& hasher) {
+    memcpy(hasher.key, IV, sizeof(hasher.key));
+    hasher.cvStackLen = 0;
+    start_chunk(hasher, 0);
+}
+
+void blake3_update(Blake3Hasher& hasher, const uint8_t* data, size_t len) {
+    while (len > 0) {
+        // A full chunk is only finished once more input shows it is not the last
+        if (hasher.blocksCompressed * 64 + hasher.blockLen == CHUNK_LEN) {
+            uint32_t full[16];
+            compress(hasher.chunkCv, hasher.block, hasher.chunkCounter, 64,
+                chunk_start_flag(hasher) | CHUNK_END, full);
+
+            uint32_t cv[8];
+            memcpy(cv, full, sizeof(cv));
+            uint64_t totalChunks = hasher.chunkCounter + 1;
+            while ((totalChunks & 1) == 0) {
+                hasher.cvStackLen--;
+                parent_cv(hasher.key, hasher.cvStack[hasher.cvStackLen], cv, 0, cv);
+                totalChunks >>= 1;
+            }
+            memcpy(hasher.cvStack[hasher.cvStackLen++], cv, sizeof(cv));
+            start_chunk(hasher, hasher.chunkCounter + 1);
+        }
+
+        if (hasher.blockLen == 64) {
+            uint32_t full[16];
+            compress(hasher.chunkCv, hasher.block, hasher.chunkCounter, 64, chunk_start_flag(hasher), full);
+            memcpy(hasher.chunkCv, full, sizeof(hasher.chunkCv));
+            hasher.blocksCompressed++;
+            hasher.blockLen = 0;
+        }
+
+        size_t take = min(64 - hasher.blockLen, len);
+        memcpy(hasher.block + hasher.blockLen, data, take);
+        hasher.blockLen += take;
+        data += take;
+        len -= take;
+    }
+}
+
+void blake3_final(const Blake3Hasher& hasher, Digest& out) {
+    uint8_t block[64] = {};
+    memcpy(block, hasher.block, hasher.blockLen);
+
+    // Pending output: the current chunk's last block, then one parent per stacked CV
+    uint32_t inputCv[8];
+    memcpy(inputCv, hasher.chunkCv, sizeof(inputCv));
+    uint64_t counter = hasher.chunkCounter;
+    uint32_t blockLen = (uint32_t)hasher.blockLen;
+    uint32_t flags = chunk_start_flag(hasher) | CHUNK_END;
+
+    for (size_t remaining = hasher.cvStackLen; remaining > 0; remaining--) {
+        uint32_t full[16];
+        compress(inputCv, block, counter, blockLen, flags, full);
+
+        const uint32_t* left = hasher.cvStack[remaining - 1];
+        for (size_t i = 0; i < 8; i++) {
+            for (size_t b = 0; b < 4; b++) {
+                block[4 * i + b] = (uint8_t)(left[i] >> (8 * b));
+                block[32 + 4 * i + b] = (uint8_t)(full[i] >> (8 * b));
+            }
+        }
+        memcpy(inputCv, hasher.key, sizeof(inputCv));
+        counter = 0;
+        blockLen = 64;
+        flags = PARENT;
+    }
+
+    uint32_t full[16];
+    compress(inputCv, block, counter, blockLen, flags | ROOT, full);
+    for (size_t i = 0; i < 8; i++)
+        for (size_t b = 0; b < 4; b++)
+            out[4 * i + b] = (uint8_t)(full[i] >> (8 * b));
+}
+
+void blake3_digest(const uint8_t* data, size_t len, Digest& out) {
+    Blake3Hasher hasher;
+    blake3_init(hasher);
+    blake3_update(hasher, data, len);
+    blake3_final(hasher, out);
+}
@@ -0,0 +1,223 @@
+#include "bounded_tree.h"
+#include <fstream>
+#include "ndjson.h"
+
+static size_t ceil_shift(size_t n, size_t level) {
+    return (n + ((size_t)1 << level) - 1) >> level;
+}
+
+static size_t tree_level_count(size_t leafCount) {
+    size_t levels = 1;
+    while (ceil_shift(leafCount, levels - 1) > 1) levels++;
+    return levels;
+}
+
+static size_t resident_bytes(size_t leafCount, size_t level) {
+    size_t count = 0;
+    for (size_t l = level; l < tree_level_count(leafCount); l++) count += ceil_shift(leafCount, l);
+    return count * sizeof(Digest);
+}
+
+size_t resident_level_for_budget(size_t leafCount, size_t budgetBytes) {
+    if (leafCount == 0) return 0;
+    size_t top = tree_level_count(leafCount) - 1;
+    size_t level = 0;
+    while (level < top && resident_bytes(leafCount, level) > budgetBytes) level++;
+    return level;
+}
+
+// Lay out the resident levels above tree.nodes, which holds level
+// residentLevel. The budget search stops at the root level, and a file
+// build only raises residentLevel by merging two complete chunks, which
+// keeps 2^residentLevel <= leafCount; a tree breaking that is refused.
+static bool build_resident_levels(BoundedMerkleTree& tree) {
+    tree.levelCount = tree_level_count(tree.leafCount);
+    if (tree.residentLevel >= tree.levelCount || tree.nodes.size() != ceil_shift(tree.leafCount, tree.residentLevel))
+        return false;
+    tree.levelOffsets.assign(1, 0);
+    size_t size = tree.nodes.size();
+    tree.nodes.reserve(resident_bytes(tree.leafCount, tree.residentLevel) / sizeof(Digest));
+
+    with_hash_policy(tree.mode, [&](auto policy) {
+        typedef decltype(policy) Policy;
+        for (size_t level = tree.residentLevel + 1; level < tree.levelCount; level++) {
+            size_t below = tree.levelOffsets.back();
+            tree.levelOffsets.push_back(tree.nodes.size());
+            for (size_t i = 0; i < size; i += 2) {
+                Digest parent = tree.nodes[below + i];
+                if (i + 1 < size) Policy::hash_node(tree.nodes[below + i], tree.nodes[below + i + 1], parent);
+                tree.nodes.push_back(parent);
+            }
+            size = (size + 1) / 2;
+        }
+    });
+    return true;
+}
+
+bool build_bounded_tree(BoundedMerkleTree& tree, size_t leafCount, size_t budgetBytes, const LeafReader& reader,
+    HashMode mode) {
+    free_bounded_tree(tree);
+    if (leafCount == 0) return false;
+
+    tree.leafCount = leafCount;
+    tree.mode = mode;
+    tree.reader = reader;
+    tree.residentLevel = resident_level_for_budget(leafCount, budgetBytes);
+
+    size_t chunk = (size_t)1 << tree.residentLevel;
+    vector<Digest> leaves(min(chunk, leafCount));
+    tree.nodes.reserve(ceil_shift(leafCount, tree.residentLevel));
+    for (size_t first = 0; first < leafCount; first += chunk) {
+        size_t count = min(chunk, leafCount - first);
+        if (!reader(first, count, leaves.data())) {
+            free_bounded_tree(tree);
+            return false;
+        }
+        tree.nodes.push_back(compute_root(leaves.data(), count, mode));
+    }
+
+    if (!build_resident_levels(tree)) {
+        free_bounded_tree(tree);
+        return false;
+    }
+    return true;
+}
+
+bool build_bounded_tree_from_file(BoundedMerkleTree& tree, const string& path, size_t budgetBytes, HashMode mode) {
+    free_bounded_tree(tree);
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) return false;
+
+    tree.mode = mode;
+    tree.path = path;
+
+    // Every resident chunk costs its node, about one more above it and its offset
+    const size_t perChunk = 2 * sizeof(Digest) + sizeof(uint64_t);
+    vector<Digest> leaves;
+    uint64_t chunkStart = 0, lineStart = 0;
+    string line, id, text;
+    // Offsets are counted from the line lengths; tellg() would seek per line
+    for (; getline(file, line); lineStart += line.size() + 1) {
+        if (!parse_review_line(line, id, text)) continue;
+
+        if (leaves.empty()) chunkStart = lineStart;
+        leaves.push_back(hash_leaf(id, text, mode));
+        tree.leafCount++;
+        if (leaves.size() < ((size_t)1 << tree.residentLevel)) continue;
+
+        tree.nodes.push_back(compute_root(leaves.data(), leaves.size(), mode));
+        tree.chunkOffsets.push_back(chunkStart);
+        leaves.clear();
+
+        // Merge chunk pairs; an odd count waits for the next chunk so that
+        // only complete chunks are ever merged
+        if (tree.nodes.size() * perChunk > budgetBytes && tree.nodes.size() % 2 == 0) {
+            for (size_t i = 0; i < tree.nodes.size() / 2; i++) {
+                hash_node(tree.nodes[2 * i], tree.nodes[2 * i + 1], tree.nodes[i], mode);
+                tree.chunkOffsets[i] = tree.chunkOffsets[2 * i];
+            }
+            tree.nodes.resize(tree.nodes.size() / 2);
+            tree.chunkOffsets.resize(tree.nodes.size());
+            tree.residentLevel++;
+        }
+    }
+    if (!leaves.empty()) {
+        tree.nodes.push_back(compute_root(leaves.data(), leaves.size(), mode));
+        tree.chunkOffsets.push_back(chunkStart);
+    }
+    if (tree.leafCount == 0) {
+        free_bounded_tree(tree);
+        return false;
+    }
+
+    if (!build_resident_levels(tree)) {
+        free_bounded_tree(tree);
+        return false;
+    }
+    return true;
+}
+
+void free_bounded_tree(BoundedMerkleTree& tree) {
+    vector<Digest>().swap(tree.nodes);
+    vector<size_t>().swap(tree.levelOffsets);
+    vector<uint64_t>().swap(tree.chunkOffsets);
+    tree.path.clear();
+    tree.reader = nullptr;
+    tree.residentLevel = 0;
+    tree.levelCount = 0;
+    tree.leafCount = 0;
+    tree.leavesRehashed = 0;
+}
+
+Digest bounded_root(const BoundedMerkleTree& tree) {
+    if (tree.nodes.empty()) return Digest{};
+    return tree.nodes.back();
+}
+
+static bool read_file_chunk(const BoundedMerkleTree& tree, size_t chunk, size_t count, Digest* out) {
+    ifstream file(tree.path, ios::binary);
+    if (!file.is_open()) return false;
+    file.seekg((streamoff)tree.chunkOffsets[chunk]);
+
+    size_t read = 0;
+    string line, id, text;
+    while (read < count && getline(file, line))
+        if (parse_review_line(line, id, text)) out[read++] = hash_leaf(id, text, tree.mode);
+    return read == count;
+}
+
+bool bounded_generate_proof(BoundedMerkleTree& tree, size_t index, ProofStep proof[], size_t& proofLen,
+    Digest* leafHash) {
+    if (index >= tree.leafCount) return false;
+
+    size_t chunk = index >> tree.residentLevel;
+    size_t first = chunk << tree.residentLevel;
+    size_t count = min((size_t)1 << tree.residentLevel, tree.leafCount - first);
+
+    // Regenerate the chunk's levels below the resident one
+    size_t total = 0;
+    for (size_t level = 0; level <= tree.residentLevel; level++) total += ceil_shift(count, level);
+    vector<Digest> levels(total);
+    bool read = tree.path.empty() ? tree.reader && tree.reader(first, count, levels.data())
+        : read_file_chunk(tree, chunk, count, levels.data());
+    if (!read) return false;
+    tree.leavesRehashed += count;
+    if (leafHash) *leafHash = levels[index - first];
+
+    proofLen = 0;
+    size_t offset = 0, size = count, pos = index - first;
+    for (size_t level = 0; level < tree.residentLevel; level++) {
+        size_t sibling = pos ^ 1;
+        if (sibling < size) {
+            proof[proofLen].siblingHash = levels[offset + sibling];
+            proof[proofLen].isLeft = (pos & 1) != 0;
+            proofLen++;
+        }
+        for (size_t i = 0; i < size; i += 2) {
+            Digest& parent = levels[offset + size + i / 2];
+            parent = levels[offset + i];
+            if (i + 1 < size) hash_node(levels[offset + i], levels[offset + i + 1], parent, tree.mode);
+        }
+        offset += size;
+        size = (size + 1) / 2;
+        pos >>= 1;
+    }
+    if (levels[offset] != tree.nodes[chunk]) return false;
+
+    pos = chunk;
+    for (size_t level = tree.residentLevel; level + 1 < tree.levelCount; level++) {
+        size_t sibling = pos ^ 1;
+        if (sibling < ceil_shift(tree.leafCount, level)) {
+            proof[proofLen].siblingHash = tree.nodes[tree.levelOffsets[level - tree.residentLevel] + sibling];
+            proof[proofLen].isLeft = (pos & 1) != 0;
+            proofLen++;
+        }
+        pos >>= 1;
+    }
+    return true;
+}
+
+size_t bounded_tree_memory_bytes(const BoundedMerkleTree& tree) {
+    return tree.nodes.capacity() * sizeof(Digest) + tree.levelOffsets.capacity() * sizeof(size_t)
+        + tree.chunkOffsets.capacity() * sizeof(uint64_t);
+}
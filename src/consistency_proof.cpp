@@ -0,0 +1,75 @@
+#include "consistency_proof.h"
+
+// Node covering leaves [start, start + size), where the range is either a
+// complete aligned power of two or runs to the end of the tree
+static const Digest& range_node(const MerkleTree& tree, size_t start, size_t size) {
+    size_t level = 0;
+    while (((size_t)1 << level) < size) level++;
+    return node_hash(tree, level, start >> level);
+}
+
+// RFC 6962 SUBPROOF(m, D[start:start+n], complete)
+static void subproof(const MerkleTree& tree, size_t m, size_t start, size_t n, bool complete,
+    vector<Digest>& proof) {
+    if (m == n) {
+        if (!complete) proof.push_back(range_node(tree, start, n));
+        return;
+    }
+    size_t k = 1;
+    while (2 * k < n) k *= 2;
+    if (m <= k) {
+        subproof(tree, m, start, k, complete, proof);
+        proof.push_back(range_node(tree, start + k, n - k));
+    }
+    else {
+        subproof(tree, m - k, start + k, n - k, false, proof);
+        proof.push_back(range_node(tree, start, k));
+    }
+}
+
+bool generate_consistency_proof(const MerkleTree& tree, size_t oldSize, vector<Digest>& proof) {
+    proof.clear();
+    if (oldSize == 0 || oldSize > tree.leafCount) return false;
+    if (oldSize < tree.leafCount) subproof(tree, oldSize, 0, tree.leafCount, true, proof);
+    return true;
+}
+
+// RFC 9162 section 2.1.4.2
+bool verify_consistency_proof(const Digest& oldRoot, size_t oldSize, const Digest& newRoot, size_t newSize,
+    const vector<Digest>& proof, HashMode mode) {
+    if (oldSize == 0 || oldSize > newSize) return false;
+    if (oldSize == newSize) return proof.empty() && oldRoot == newRoot;
+
+    // A power-of-two old tree is itself a node of the new one and is left
+    // out of the proof
+    bool oldIsSubtree = (oldSize & (oldSize - 1)) == 0;
+    if (proof.empty() && !oldIsSubtree) return false;
+
+    size_t fn = oldSize - 1, sn = newSize - 1;
+    while (fn & 1) {
+        fn >>= 1;
+        sn >>= 1;
+    }
+
+    size_t next = 0;
+    Digest fr = oldIsSubtree ? oldRoot : proof[next++];
+    Digest sr = fr;
+    for (; next < proof.size(); next++) {
+        const Digest& c = proof[next];
+        if (sn == 0) return false;
+        if ((fn & 1) || fn == sn) {
+            hash_node(c, fr, fr, mode);
+            hash_node(c, sr, sr, mode);
+            while (!(fn & 1) && fn != 0) {
+                fn >>= 1;
+                sn >>= 1;
+            }
+        }
+        else {
+            hash_node(sr, c, sr, mode);
+        }
+        fn >>= 1;
+        sn >>= 1;
+    }
+    return sn == 0 && fr == oldRoot && sr == newRoot;
+}
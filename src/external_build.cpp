@@ -0,0 +1,176 @@
+#include "external_build.h"
+
+static const size_t IO_ALIGN = 4096;
+
+string external_level_path(const string& dir, size_t level) {
+    return dir + "/level_" + to_string(level) + ".bin";
+}
+
+// Unbuffered stdio: every transfer already goes through our own large buffers
+static FILE* open_level(const string& path, const char* mode) {
+    FILE* file = fopen(path.c_str(), mode);
+    if (file) setvbuf(file, nullptr, _IONBF, 0);
+    return file;
+}
+
+static void write_digests(ExternalTreeBuilder& builder, FILE* file, const Digest* digests, size_t count) {
+    size_t written = fwrite(digests, sizeof(Digest), count, file);
+    if (written != count) builder.failed = true;
+    builder.bytesWritten += written * sizeof(Digest);
+}
+
+bool init_external_builder(ExternalTreeBuilder& builder, const string& dir, HashMode mode, size_t bufferBytes,
+    unsigned threads) {
+    arena_release(builder.arena);
+    builder.dir = dir;
+    builder.mode = mode;
+    builder.threads = threads;
+    builder.bufferDigests = max(bufferBytes / sizeof(Digest) & ~(size_t)1, (size_t)2);
+    builder.leafBuffer = (Digest*)arena_alloc(builder.arena, builder.bufferDigests * sizeof(Digest), IO_ALIGN);
+    builder.buffered = 0;
+    builder.leafCount = 0;
+    builder.levelCount = 0;
+    builder.bytesWritten = 0;
+    builder.bytesRead = 0;
+    builder.failed = false;
+
+    builder.leafFile = open_level(external_level_path(dir, 0), "wb");
+    if (!builder.leafFile) {
+        arena_release(builder.arena);
+        builder.failed = true;
+        return false;
+    }
+    start_worker_pool(builder.pool, resolve_thread_count(threads));
+    return true;
+}
+
+static void flush_leaves(ExternalTreeBuilder& builder) {
+    write_digests(builder, builder.leafFile, builder.leafBuffer, builder.buffered);
+    builder.buffered = 0;
+}
+
+void external_append_leaf(ExternalTreeBuilder& builder, const Digest& leaf) {
+    builder.leafBuffer[builder.buffered++] = leaf;
+    builder.leafCount++;
+    if (builder.buffered == builder.bufferDigests) flush_leaves(builder);
+}
+
+void external_append(ExternalTreeBuilder& builder, const string& reviewID, const string& reviewText) {
+    external_append_leaf(builder, hash_leaf(reviewID, reviewText, builder.mode));
+}
+
+void external_append_chunk(ExternalTreeBuilder& builder, const string* reviewIDs, const string* reviewTexts,
+    size_t n) {
+    while (n > 0) {
+        size_t take = min(n, builder.bufferDigests - builder.buffered);
+        Digest* out = builder.leafBuffer + builder.buffered;
+        pool_for(builder.pool, take, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) out[i] = hash_leaf(reviewIDs[i], reviewTexts[i], builder.mode);
+        });
+        builder.buffered += take;
+        builder.leafCount += take;
+        if (builder.buffered == builder.bufferDigests) flush_leaves(builder);
+        reviewIDs += take;
+        reviewTexts += take;
+        n -= take;
+    }
+}
+
+// One pass from a child level file to its parent. The next block is read
+// in the background while the current one is hashed; blocks hold an even
+// number of digests, so only the final one can end in a promoted node.
+template <typename Policy>
+static void build_parent_level(ExternalTreeBuilder& builder, FILE* in, uint64_t childCount, FILE* out,
+    Digest* current, Digest* next, Digest* parents) {
+    size_t block = builder.bufferDigests;
+    auto read_block = [in, block](Digest* buffer) { return fread(buffer, sizeof(Digest), block, in); };
+    size_t got = 0;
+    future<void> pending = pool_submit(builder.pool, [&, current] { got = read_block(current); });
+    uint64_t done = 0;
+    while (done < childCount) {
+        pending.get();
+        size_t ready = got;
+        if (ready == 0) {
+            builder.failed = true;
+            return;
+        }
+        builder.bytesRead += ready * sizeof(Digest);
+        done += ready;
+        if (done < childCount) pending = pool_submit(builder.pool, [&, next] { got = read_block(next); });
+
+        size_t pairs = ready / 2;
+        pool_for(builder.pool, pairs, [&](size_t first, size_t last) {
+            Policy::hash_pairs(current + 2 * first, last - first, parents + first);
+        });
+        if (ready & 1) parents[pairs] = current[ready - 1];
+        write_digests(builder, out, parents, (ready + 1) / 2);
+        swap(current, next);
+    }
+}
+
+// Removes the level files of a build when it goes out of scope, however
+// finish_external_build() leaves; levels [0, levels) may exist
+struct LevelFileCleanup {
+    const ExternalTreeBuilder& builder;
+    size_t levels = 1;
+    bool keep = false;
+
+    ~LevelFileCleanup() {
+        if (keep) return;
+        for (size_t level = 0; level < levels; level++) remove(external_level_path(builder.dir, level).c_str());
+    }
+};
+
+bool finish_external_build(ExternalTreeBuilder& builder, Digest& root) {
+    LevelFileCleanup cleanup{ builder };
+    if (builder.leafFile) {
+        flush_leaves(builder);
+        if (fclose(builder.leafFile) != 0) builder.failed = true;
+        builder.leafFile = nullptr;
+    }
+
+    // The leaf buffer is reused as one of the two read buffers
+    size_t block = builder.bufferDigests;
+    Digest* readAhead = (Digest*)arena_alloc(builder.arena, block * sizeof(Digest), IO_ALIGN);
+    Digest* parents = (Digest*)arena_alloc(builder.arena, block / 2 * sizeof(Digest), IO_ALIGN);
+
+    uint64_t count = builder.leafCount;
+    size_t level = 0;
+    while (!builder.failed && count > 1) {
+        cleanup.levels = level + 2;
+        FILE* in = open_level(external_level_path(builder.dir, level), "rb");
+        FILE* out = open_level(external_level_path(builder.dir, level + 1), "wb");
+        if (in && out) {
+            with_hash_policy(builder.mode, [&](auto policy) {
+                build_parent_level<decltype(policy)>(builder, in, count, out, builder.leafBuffer, readAhead,
+                    parents);
+            });
+        }
+        else {
+            builder.failed = true;
+        }
+        if (in) fclose(in);
+        if (out && fclose(out) != 0) builder.failed = true;
+        // A finished child level is only needed if the files are kept
+        if (!builder.keepLevelFiles) remove(external_level_path(builder.dir, level).c_str());
+        count = (count + 1) / 2;
+        level++;
+    }
+    builder.levelCount = level + 1;
+    stop_worker_pool(builder.pool);
+
+    // The top level file holds just the root
+    bool ok = !builder.failed && builder.leafCount > 0;
+    if (ok) {
+        FILE* top = open_level(external_level_path(builder.dir, level), "rb");
+        ok = top && fread(root.data(), sizeof(Digest), 1, top) == 1;
+        if (top) fclose(top);
+        if (ok) builder.bytesRead += sizeof(Digest);
+    }
+    cleanup.keep = ok && builder.keepLevelFiles;
+
+    arena_release(builder.arena);
+    builder.leafBuffer = nullptr;
+    builder.buffered = 0;
+    return ok;
+}
@@ -0,0 +1,122 @@
+#include "hash_policy.h"
+#include <algorithm>
+#include <cstring>
+
+static const char HEX_DIGITS[] = "0123456789abcdef";
+
+static void hex_pair(const Digest& left, const Digest& right, char buf[128]) {
+    for (size_t i = 0; i < 32; i++) {
+        buf[2 * i] = HEX_DIGITS[left[i] >> 4];
+        buf[2 * i + 1] = HEX_DIGITS[left[i] & 0x0f];
+        buf[64 + 2 * i] = HEX_DIGITS[right[i] >> 4];
+        buf[64 + 2 * i + 1] = HEX_DIGITS[right[i] & 0x0f];
+    }
+}
+
+static void sha256_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out) {
+    Sha256State state;
+    sha256_init(state);
+    sha256_update(state, a, aLen);
+    sha256_update(state, b, bLen);
+    sha256_final(state, out);
+}
+
+void Sha256HexPolicy::hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out) {
+    sha256_concat(a, aLen, b, bLen, out);
+}
+
+void Sha256HexPolicy::hash_node(const Digest& left, const Digest& right, Digest& out) {
+    char buf[128];
+    hex_pair(left, right, buf);
+    sha256_digest((const uint8_t*)buf, sizeof(buf), out);
+}
+
+// Node messages all have the same length, so they go through the
+// multi-buffer kernel 16 at a time
+void Sha256HexPolicy::hash_pairs(const Digest* pairs, size_t count, Digest* out) {
+    const size_t group = 16;
+    const uint8_t* messages[group];
+    char hexBuf[group][128];
+
+    for (size_t k = 0; k < count; k += group) {
+        size_t n = min(group, count - k);
+        for (size_t m = 0; m < n; m++) {
+            hex_pair(pairs[2 * (k + m)], pairs[2 * (k + m) + 1], hexBuf[m]);
+            messages[m] = (const uint8_t*)hexBuf[m];
+        }
+        sha256_multi(messages, 128, n, out + k);
+    }
+}
+
+void Sha256Policy::hash_node(const Digest& left, const Digest& right, Digest& out) {
+    uint8_t buf[64];
+    memcpy(buf, left.data(), 32);
+    memcpy(buf + 32, right.data(), 32);
+    sha256_digest(buf, sizeof(buf), out);
+}
+
+void Sha256Policy::hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out) {
+    sha256_concat(a, aLen, b, bLen, out);
+}
+
+// Each pair is already a contiguous 64-byte message inside the level array
+void Sha256Policy::hash_pairs(const Digest* pairs, size_t count, Digest* out) {
+    const size_t group = 16;
+    const uint8_t* messages[group];
+
+    for (size_t k = 0; k < count; k += group) {
+        size_t n = min(group, count - k);
+        for (size_t m = 0; m < n; m++)
+            messages[m] = pairs[2 * (k + m)].data();
+        sha256_multi(messages, 64, n, out + k);
+    }
+}
+
+void Blake3Policy::hash_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out) {
+    Blake3Hasher hasher;
+    blake3_init(hasher);
+    blake3_update(hasher, a, aLen);
+    blake3_update(hasher, b, bLen);
+    blake3_final(hasher, out);
+}
+
+void Blake3Policy::hash_node(const Digest& left, const Digest& right, Digest& out) {
+    uint8_t buf[64];
+    memcpy(buf, left.data(), 32);
+    memcpy(buf + 32, right.data(), 32);
+    blake3_digest(buf, sizeof(buf), out);
+}
+
+// A 64-byte node is a single BLAKE3 block, so there is nothing to batch
+void Blake3Policy::hash_pairs(const Digest* pairs, size_t count, Digest* out) {
+    for (size_t k = 0; k < count; k++)
+        blake3_digest(pairs[2 * k].data(), 64, out[k]);
+}
+
+void Xxh3Policy::hash_node(const Digest& left, const Digest& right, Digest& out) {
+    uint8_t buf[32];
+    memcpy(buf, left.data(), 16);
+    memcpy(buf + 16, right.data(), 16);
+    xxh3_128_digest(buf, sizeof(buf), out);
+}
+
+void Xxh3Policy::hash_pairs(const Digest* pairs, size_t count, Digest* out) {
+    for (size_t k = 0; k < count; k++)
+        hash_node(pairs[2 * k], pairs[2 * k + 1], out[k]);
+}
+
+const char* hash_mode_name(HashMode mode) {
+    switch (mode) {
+    case HASH_MODE_HEX_CONCAT: return "sha256-hex";
+    case HASH_MODE_BINARY: return "sha256";
+    case HASH_MODE_BLAKE3: return "blake3";
+    case HASH_MODE_XXH3_128: return "xxh3-128";
+    }
+    return "unknown";
+}
+
+bool hash_mode_from_version(unsigned version, HashMode& mode) {
+    if (version < HASH_MODE_HEX_CONCAT || version > HASH_MODE_XXH3_128) return false;
+    mode = (HashMode)version;
+    return true;
+}
@@ -4,7 +4,19 @@
 #include <string>
 #include <cstdlib>
 #include <vector>
+#include <algorithm>
 #include "merkle_tree.h"
+#include "merkle_stream.h"
+#include "parallel.h"
+#include "tree_image.h"
+#include "tree_versions.h"
+#include "sparse_merkle.h"
+#include "consistency_proof.h"
+#include "proof_format.h"
+#include "bounded_tree.h"
+#include "external_build.h"
+#include "pipeline.h"
+#include "ndjson.h"
 #include "picosha2.h"
 #include "json.hpp"
 #include <queue>
@@ -12,6 +24,7 @@
 #include <map>
 #include <functional>
 #include <chrono>
+#include <numeric>
 #include <random>
 #include <thread>
 #include <future>
@@ -21,9 +34,13 @@ using json = nlohmann::json;
 
 Menu::Menu() {
     treeBuilt = false;
+    sparseBuilt = false;
+    buildThreads = 0;
+    hashMode = HASH_MODE_BINARY;
 }
 
 Menu::~Menu() {
+    free_version_store(versions);
     free_merkle_tree(tree);
 }
 
@@ -40,6 +57,15 @@ void Menu::display() {
     cout << "7. Simulate Tampering" << endl;
     cout << "8. Visualize Merkle Tree" << endl;
     cout << "9. Run Performance Tests" << endl;  
+    cout << "10. Stream Merkle Root From File" << endl;
+    cout << "11. Select Hash Algorithm (current: " << hash_mode_name(hashMode) << ")" << endl;
+    cout << "12. Open Saved Tree Image" << endl;
+    cout << "13. Tree Versions" << endl;
+    cout << "14. Sparse Proof by Review ID (membership / absence)" << endl;
+    cout << "15. Consistency Proof From an Earlier Size" << endl;
+    cout << "16. Memory-Bounded Tree From File" << endl;
+    cout << "17. External-Memory Build From File" << endl;
+    cout << "18. Load and Build in One Pass (pipelined)" << endl;
     cout << "0. Exit" << endl;
     cout << "Choose an option: ";
 }
@@ -66,6 +92,15 @@ void Menu::handleInput() {
         case 7: simulateTampering(); break;
         case 8: visualizeTree(); break;
         case 9: runPerformanceTests(); break;  
+        case 10: streamRoot(); break;
+        case 11: selectHashAlgorithm(); break;
+        case 12: openTreeImage(); break;
+        case 13: manageVersions(); break;
+        case 14: generateSparseProof(); break;
+        case 15: generateConsistencyProof(); break;
+        case 16: buildBoundedTree(); break;
+        case 17: buildExternalTree(); break;
+        case 18: loadAndBuild(); break;
         case 0: cout << "Exiting..." << endl; return;
         default: cout << "Invalid option! Try again.\n";
         }
@@ -82,30 +117,94 @@ void Menu::loadDataset() {
         return;
     }
 
-    ifstream file(filename);
-    if (!file.is_open()) {
+    auto start = std::chrono::high_resolution_clock::now();
+    vector<string> ids, texts;
+    NdjsonStats stats;
+    bool opened = load_review_file(filename, ids, texts, buildThreads, &stats);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!opened) {
         cout << "Could not open dataset file: " << filename << "\n";
         return;
     }
 
-    reviewIDs.clear();
-    reviewTexts.clear();
+    reviewIDs.swap(ids);
+    reviewTexts.swap(texts);
+    sparseBuilt = false;
 
-    string line;
-    while (getline(file, line)) {
-        if (line.empty()) continue;
-        try {
-            json j = json::parse(line);
-            if (j.contains("reviewID") && j.contains("reviewText")) {
-                reviewIDs.push_back(j["reviewID"].get<string>());
-                reviewTexts.push_back(j["reviewText"].get<string>());
-            }
-        }
-        catch (...) { continue; }
+    cout << "Loaded " << reviewIDs.size() << " reviews from " << filename << " in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+        << stats.fallbacks << " of " << stats.lines << " lines needed the full JSON parser)\n";
+}
+
+// ===== Stream Merkle Root =====
+// Hashes the file record by record without keeping any review in memory
+void Menu::streamRoot() {
+    if (stream.leafCount > 0) {
+        cout << "Append to the current stream of " << stream.leafCount << " reviews? (y/n): ";
+        string answer;
+        getline(cin, answer);
+        if (answer.empty() || (answer[0] != 'y' && answer[0] != 'Y'))
+            init_merkle_stream(stream, hashMode);
+    }
+    else {
+        init_merkle_stream(stream, hashMode);
+    }
+
+    string filename;
+    cout << "Enter dataset filename to stream: ";
+    if (!(cin >> filename)) {
+        cout << "Invalid filename input.\n";
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    size_t streamed = 0;
+    bool opened = scan_review_file(filename, [this, &streamed](string& id, string& text) {
+        stream_append(stream, id, text);
+        streamed++;
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!opened) {
+        cout << "Could not open dataset file: " << filename << "\n";
+        return;
     }
 
-    file.close();
-    cout << "Loaded " << reviewIDs.size() << " reviews from " << filename << "\n";
+    size_t frontierNodes = 0;
+    for (uint64_t bits = stream.leafCount; bits; bits >>= 1) frontierNodes += bits & 1;
+
+    cout << "Streamed " << streamed << " reviews in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms (total "
+        << stream.leafCount << ", frontier " << frontierNodes * sizeof(Digest) << " bytes)\n";
+    cout << "Stream root hash (" << hash_mode_name(stream.mode) << "): " << digest_to_hex(stream_root(stream)) << "\n";
+}
+
+// ===== Select Hash Algorithm =====
+// Applies to every tree built afterwards; an existing tree is rebuilt
+void Menu::selectHashAlgorithm() {
+    const HashMode modes[] = { HASH_MODE_HEX_CONCAT, HASH_MODE_BINARY, HASH_MODE_BLAKE3, HASH_MODE_XXH3_128 };
+    for (HashMode mode : modes)
+        cout << (int)mode << ". " << hash_mode_name(mode) << (mode == hashMode ? " (current)" : "") << "\n";
+    cout << "XXH3-128 is not cryptographic; use it only for change detection on trusted data.\n";
+    cout << "Choose an algorithm: ";
+
+    unsigned version;
+    HashMode chosen;
+    if (!(cin >> version) || !hash_mode_from_version(version, chosen)) {
+        cout << "Invalid algorithm.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    hashMode = chosen;
+    cout << "Hash algorithm set to " << hash_mode_name(hashMode) << ".\n";
+
+    if (treeBuilt && tree.mode != hashMode) {
+        free_merkle_tree(tree);
+        init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
+        startVersionHistory();
+        cout << "Tree rebuilt. Root hash: " << digest_to_hex(get_merkle_root(tree)) << "\n";
+    }
 }
 
 // ===== Build Merkle Tree =====
@@ -116,11 +215,12 @@ void Menu::buildMerkleTree() {
     }
 
     free_merkle_tree(tree);
-    init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size());
+    init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
     treeBuilt = true;
+    startVersionHistory();
 
-    cout << "Merkle Tree built successfully.\n";
-    cout << "Root hash: " << get_merkle_root(tree) << "\n";
+    cout << "Merkle Tree built successfully (" << hash_mode_name(tree.mode) << ").\n";
+    cout << "Root hash: " << digest_to_hex(get_merkle_root(tree)) << "\n";
 }
 
 // ===== Save Merkle Root =====
@@ -131,9 +231,39 @@ void Menu::saveRoot() {
         cout << "Could not open merkle_root.txt for writing.\n";
         return;
     }
-    out << get_merkle_root(tree);
+    // Root followed by the hash mode version and algorithm it was computed with
+    out << digest_to_hex(get_merkle_root(tree)) << "\nv" << (int)tree.mode << " " << hash_mode_name(tree.mode) << "\n";
     out.close();
     cout << "Merkle Root saved to merkle_root.txt\n";
+
+    // The whole tree, so a later session can serve proofs without rebuilding
+    if (save_tree_image(tree, "merkle_tree.img"))
+        cout << "Tree image saved to merkle_tree.img (" << tree.nodeCount * sizeof(Digest) / (1024.0 * 1024.0)
+        << " MB of nodes)\n";
+    else
+        cout << "Could not write merkle_tree.img.\n";
+}
+
+// ===== Open Saved Tree Image =====
+// Maps merkle_tree.img; proofs by index work immediately, lookups by review
+// ID need the dataset and a rebuild
+void Menu::openTreeImage() {
+    free_merkle_tree(tree);
+    treeBuilt = false;
+    startVersionHistory();
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!open_tree_image("merkle_tree.img", tree)) {
+        cout << "Could not open merkle_tree.img (missing or not a valid tree image).\n";
+        return;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    treeBuilt = true;
+    startVersionHistory();
+
+    cout << "Opened tree image with " << tree.leafCount << " leaves (" << hash_mode_name(tree.mode) << ") in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+    cout << "Root hash: " << digest_to_hex(get_merkle_root(tree)) << "\n";
 }
 
 // ===== Compare Merkle Roots =====
@@ -142,15 +272,78 @@ void Menu::compareRoot() {
     ifstream in("merkle_root.txt");
     if (!in.is_open()) { cout << "No saved root to compare.\n"; return; }
 
-    string savedRoot;
-    in >> savedRoot;
+    string savedRoot, savedVersion;
+    in >> savedRoot >> savedVersion;
     in.close();
 
-    string currentRoot = get_merkle_root(tree);
-    if (savedRoot == currentRoot)
+    // Files without a version tag predate v2 and hold hex-concatenation roots
+    HashMode savedMode = HASH_MODE_HEX_CONCAT;
+    if (savedVersion.size() > 1 && savedVersion[0] == 'v' &&
+        !hash_mode_from_version((unsigned)atoi(savedVersion.c_str() + 1), savedMode)) {
+        cout << "Saved root uses an unknown hash algorithm (" << savedVersion << ").\n";
+        return;
+    }
+
+    Digest saved;
+    if (!hex_to_digest(savedRoot, saved)) { cout << "Saved root is not a valid hash.\n"; return; }
+
+    // Both SHA-256 modes share leaf hashes, so only the internal levels need
+    // recomputing; any other algorithm has to rehash the reviews themselves
+    bool sameLeaves = savedMode == tree.mode ||
+        ((savedMode == HASH_MODE_HEX_CONCAT || savedMode == HASH_MODE_BINARY) &&
+         (tree.mode == HASH_MODE_HEX_CONCAT || tree.mode == HASH_MODE_BINARY));
+    Digest currentRoot;
+    if (savedMode == tree.mode) {
+        currentRoot = get_merkle_root(tree);
+    }
+    else if (sameLeaves) {
+        currentRoot = compute_root(tree.nodes, tree.leafCount, savedMode);
+    }
+    else {
+        if (reviewIDs.size() != tree.leafCount) {
+            cout << "Load the dataset to recompute the root with " << hash_mode_name(savedMode) << ".\n";
+            return;
+        }
+        vector<Digest> leaves(reviewIDs.size());
+        for (size_t i = 0; i < leaves.size(); i++)
+            leaves[i] = hash_leaf(reviewIDs[i], reviewTexts[i], savedMode);
+        currentRoot = compute_root(leaves.data(), leaves.size(), savedMode);
+    }
+    if (savedMode != tree.mode)
+        cout << "Saved root uses " << hash_mode_name(savedMode) << "; recomputed the current root with it.\n";
+    if (saved == currentRoot) {
         cout << "Integrity Verified: Roots match.\n";
-    else
-        cout << "Data Integrity Violated: Roots do not match!\n";
+        return;
+    }
+    cout << "Data Integrity Violated: Roots do not match!\n";
+
+    // The image saved with the root localizes the changed reviews
+    MerkleTree savedTree;
+    if (!open_tree_image("merkle_tree.img", savedTree) || get_merkle_root(savedTree) != saved) {
+        cout << "No matching merkle_tree.img to locate the changed reviews.\n";
+    }
+    else {
+        vector<size_t> changed;
+        size_t compared = 0;
+        if (diff_trees(savedTree, tree, changed, &compared))
+            printDifferences(changed, compared);
+        else
+            cout << "Saved tree has a different size or hash algorithm; cannot locate changes.\n";
+    }
+    free_merkle_tree(savedTree);
+}
+
+void Menu::printDifferences(const vector<size_t>& changed, size_t nodesCompared) {
+    const size_t shown = 20;
+    cout << changed.size() << " review(s) differ (" << nodesCompared << " nodes compared for "
+        << tree.leafCount << " leaves):\n";
+    for (size_t k = 0; k < changed.size() && k < shown; k++) {
+        size_t index = changed[k];
+        cout << "  index " << index;
+        if (index < reviewIDs.size()) cout << " | reviewID " << reviewIDs[index];
+        cout << "\n";
+    }
+    if (changed.size() > shown) cout << "  ... and " << changed.size() - shown << " more\n";
 }
 
 // ===== Generate Merkle Proof =====
@@ -162,39 +355,89 @@ void Menu::generateProof() {
     getline(cin, id);
     if (id.empty()) getline(cin, id);
 
-    int index = -1;
-    try { index = stoi(id); }
-    catch (...) { index = -1; }
-
-    if (index >= 0 && index < reviewIDs.size()) { /* numeric index */ }
-    else {
-        for (size_t i = 0; i < reviewIDs.size(); i++)
-            if (reviewIDs[i] == id) { index = i; break; }
+    size_t index = 0;
+    bool found = false;
+    try {
+        long long numeric = stoll(id);
+        if (numeric >= 0 && (size_t)numeric < tree.leafCount) {
+            index = (size_t)numeric;
+            found = true;
+        }
     }
+    catch (...) {}
 
-    if (index == -1) { cout << "Review ID not found!\n"; return; }
+    if (!found) found = find_leaf_by_id(tree, id, index);
 
-    string leafHash = picosha2::hash256_hex_string(reviewIDs[index] + reviewTexts[index]);
-    cout << "Leaf hash used for proof: " << leafHash << "\n";
+    if (!found) { cout << "Review ID not found!\n"; return; }
+
+    // Without a matching dataset (tree opened from an image) the stored leaf is proven
+    Digest leafHash = treeMatchesDataset(index)
+        ? hash_leaf(reviewIDs[index], reviewTexts[index], tree.mode)
+        : tree.nodes[index];
+    cout << "Leaf hash used for proof: " << digest_to_hex(leafHash) << "\n";
 
     vector<ProofStep> proof(512);
     size_t proofLen = 0;
 
-    if (!generate_proof(tree, leafHash, proof.data(), proofLen)) {
+    if (!generate_proof_by_index(tree, index, proof.data(), proofLen)) {
         cout << "ERROR: Could not generate proof for this review.\n";
         return;
     }
 
-    bool ok = verify_proof(leafHash, proof.data(), proofLen, get_merkle_root(tree));
+    bool ok = verify_proof(leafHash, proof.data(), proofLen, get_merkle_root(tree), tree.mode);
     cout << "Verification result: " << (ok ? "NO TAMPERING DETECTED" : "TAMPERING DETECTED") << "\n";
 
     for (size_t i = 0; i < proofLen; i++)
-        cout << "Step " << i << " | SiblingHash = " << proof[i].siblingHash
+        cout << "Step " << i << " | SiblingHash = " << digest_to_hex(proof[i].siblingHash)
         << " | isLeft = " << proof[i].isLeft << "\n";
 
+    vector<uint8_t> encoded;
+    serialize_proof(proof.data(), proofLen, index, tree.leafCount, tree.mode, encoded);
+    ofstream out("merkle_proof.bin", ios::binary);
+    out.write((const char*)encoded.data(), encoded.size());
+    out.close();
+    bool encodedOk = verify_serialized_proof(encoded.data(), encoded.size(), leafHash, get_merkle_root(tree), tree.mode);
+    cout << "Binary proof saved to merkle_proof.bin (" << encoded.size() << " bytes, "
+        << (encodedOk ? "verifies" : "does NOT verify") << " from the buffer)\n";
+
     visualizeProofTree(leafHash, proof, proofLen);
 }
 
+// ===== Sparse Merkle Proof =====
+// Keyed by SHA-256(reviewID), so absent IDs get a proof too
+void Menu::generateSparseProof() {
+    if (reviewIDs.empty()) { cout << "Load dataset first!\n"; return; }
+
+    if (!sparseBuilt || sparse.mode != hashMode) {
+        auto start = std::chrono::high_resolution_clock::now();
+        build_sparse_tree(sparse, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
+        auto end = std::chrono::high_resolution_clock::now();
+        sparseBuilt = true;
+        cout << "Sparse Merkle tree built over " << sparse.leaves.size() << " review IDs in "
+            << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+            << sparse.nodes.size() << " stored nodes)\n";
+    }
+    Digest root = sparse_root(sparse);
+    cout << "Sparse root hash: " << digest_to_hex(root) << "\n";
+
+    cout << "Enter Review ID: ";
+    string id;
+    getline(cin, id);
+    if (id.empty()) getline(cin, id);
+
+    SparseProof proof;
+    bool present = generate_sparse_proof(sparse, id, proof);
+    bool ok = present
+        ? verify_sparse_membership(root, id, proof.leafValue, proof, sparse.mode)
+        : verify_sparse_absence(root, id, proof, sparse.mode);
+
+    cout << (present ? "Review ID is present" : "Review ID is absent") << "; proof of "
+        << proof.siblings.size() << " non-empty siblings, path depth " << proof.depth << ", "
+        << (proof.terminalLeaf ? "ends at leaf " + digest_to_hex(proof.leafKey).substr(0, 16) + "..." : string("ends in an empty subtree"))
+        << "\n";
+    cout << "Verification result: " << (ok ? "VERIFIED" : "FAILED") << "\n";
+}
+
 void Menu::modifyReview() {
     if (reviewTexts.empty()) { cout << "Load dataset first!\n"; return; }
 
@@ -213,35 +456,162 @@ void Menu::modifyReview() {
     cout << "Enter new review text: ";
     string newText; getline(cin, newText);
     reviewTexts[idx] = newText;
+    if (sparseBuilt) sparse_insert(sparse, reviewIDs[idx], reviewTexts[idx]);
+
+    // Only a tree built from this dataset can be patched in place
+    if (!treeMatchesDataset(idx)) {
+        free_merkle_tree(tree);
+        init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
+        treeBuilt = true;
+        startVersionHistory();
+        cout << "Review updated. Merkle tree rebuilt from the loaded dataset.\n";
+        return;
+    }
 
-    free_merkle_tree(tree);
-    init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size());
-    treeBuilt = true;
+    // The live tree's path is rehashed in place; earlier versions keep a
+    // copy of the old path and share everything else
+    auto start = std::chrono::high_resolution_clock::now();
+    pair<size_t, string> change(idx, reviewTexts[idx]);
+    uint64_t id;
+    bool updated = commit_version(versions, tree, &change, 1, id);
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!updated) { cout << "Could not update leaf " << idx << ".\n"; return; }
+
+    cout << "Review updated. Leaf-to-root path rehashed in "
+        << std::chrono::duration<double, std::micro>(end - start).count() << " us.\n";
+    cout << "New root hash: " << digest_to_hex(get_merkle_root(tree)) << "\n";
+    cout << "Recorded as version " << id << " (" << versions.liveNodes << " overlay nodes across "
+        << versions.versions.size() << " versions)\n";
+}
 
-    cout << "Review updated. Merkle tree rebuilt.\n";
+bool Menu::treeMatchesDataset(size_t index) const {
+    return treeBuilt && !tree.leafIds.empty() && tree.leafCount == reviewIDs.size() && index < tree.leafCount &&
+        *tree.leafIds[index] == reviewIDs[index];
 }
 
-void Menu::simulateTampering() {
-    if (!treeBuilt) { cout << "Build the Merkle tree first!\n"; return; }
-    if (reviewIDs.empty() || reviewTexts.empty()) { cout << "No reviews available.\n"; return; }
+// The history refers to the tree's own nodes, so it restarts (or ends)
+// whenever the tree is rebuilt or dropped
+void Menu::startVersionHistory() {
+    if (treeBuilt) init_version_store(versions, tree);
+    else free_version_store(versions);
+}
 
-    string leafHash = picosha2::hash256_hex_string(reviewIDs[0] + reviewTexts[0]);
+// ===== Tree Versions =====
+void Menu::manageVersions() {
+    if (versions.versions.empty()) { cout << "Build the tree first!\n"; return; }
 
-    vector<ProofStep> proof(512);
-    size_t proofLen = 0;
+    for (const TreeVersion& version : versions.versions)
+        cout << "Version " << version.id << " | root " << digest_to_hex(version.rootHash) << "\n";
+    cout << "History uses " << version_store_memory_bytes(versions) / (1024.0 * 1024.0) << " MB ("
+        << versions.liveNodes << " overlay nodes)\n";
+    cout << "1. Proof against a version\n2. Release a version\n0. Back\nChoose: ";
+
+    int choice;
+    uint64_t id;
+    if (!(cin >> choice) || choice == 0) {
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    cout << "Version id: ";
+    if (!(cin >> id)) {
+        cout << "Invalid version.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+
+    if (choice == 2) {
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        if (id == versions.headId)
+            cout << "Version " << id << " is the current tree and cannot be released.\n";
+        else if (release_version(versions, id))
+            cout << "Version " << id << " released; " << versions.liveNodes << " overlay nodes remain.\n";
+        else
+            cout << "No such version.\n";
+        return;
+    }
 
-    if (!generate_proof(tree, leafHash, proof.data(), proofLen)) {
-        cout << "ERROR: Could not generate proof for tamper check.\n";
+    cout << "Review index: ";
+    size_t index;
+    if (!(cin >> index)) {
+        cout << "Invalid index.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
         return;
     }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
 
-    bool ok = verify_proof(leafHash, proof.data(), proofLen, get_merkle_root(tree));
-    cout << (ok ? "NO TAMPERING DETECTED\n" : "TAMPERING DETECTED\n");
+    const TreeVersion* version = find_version(versions, id);
+    vector<ProofStep> proof(64);
+    size_t proofLen = 0;
+    if (!version || !version_generate_proof(versions, id, index, proof.data(), proofLen)) {
+        cout << "No such version or index.\n";
+        return;
+    }
+
+    Digest leaf = version_leaf(versions, id, index);
+    bool ok = verify_proof(leaf, proof.data(), proofLen, version->rootHash, versions.mode);
+    cout << "Leaf in version " << id << ": " << digest_to_hex(leaf) << "\n";
+    cout << "Proof of " << proofLen << " steps against root " << digest_to_hex(version->rootHash) << ": "
+        << (ok ? "VERIFIED" : "FAILED") << "\n";
+    if (index < reviewIDs.size() && hash_leaf(reviewIDs[index], reviewTexts[index], versions.mode) != leaf)
+        cout << "The current review text differs from this version.\n";
+}
+
+// Tamper with a few random reviews in a scratch tree and check that the
+// diff against the real tree finds exactly those reviews
+void Menu::simulateTampering() {
+    if (!treeBuilt) { cout << "Build the Merkle tree first!\n"; return; }
+    if (reviewIDs.size() != tree.leafCount) { cout << "Load the dataset the tree was built from first.\n"; return; }
+
+    cout << "How many reviews to tamper with? ";
+    size_t k;
+    if (!(cin >> k) || k == 0) {
+        cout << "Invalid count.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    k = min(k, reviewIDs.size());
+
+    // k distinct positions from a partial Fisher-Yates shuffle
+    size_t n = reviewIDs.size();
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), (size_t)0);
+    mt19937_64 rng(random_device{}());
+    for (size_t j = 0; j < k; j++)
+        swap(order[j], order[uniform_int_distribution<size_t>(j, n - 1)(rng)]);
+    vector<size_t> tampered(order.begin(), order.begin() + k);
+    sort(tampered.begin(), tampered.end());
+
+    // Patch a copy of the tree, so forging costs O(k log n) hashes and the
+    // loaded texts are never touched
+    vector<pair<size_t, string>> edits(k);
+    for (size_t j = 0; j < k; j++) edits[j] = { tampered[j], reviewTexts[tampered[j]] + " [tampered]" };
+    MerkleTree forged;
+    copy_tree_nodes(tree, forged);
+    forged.leafIds.resize(n);
+    for (size_t i = 0; i < n; i++) forged.leafIds[i] = &reviewIDs[i];
+    apply_updates(forged, edits.data(), edits.size(), buildThreads);
+
+    vector<size_t> changed;
+    size_t compared = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    diff_trees(tree, forged, changed, &compared);
+    auto end = std::chrono::high_resolution_clock::now();
+    free_merkle_tree(forged);
+
+    cout << (changed.empty() ? "NO TAMPERING DETECTED\n" : "TAMPERING DETECTED\n");
+    printDifferences(changed, compared);
+    cout << "Located in " << std::chrono::duration<double, std::micro>(end - start).count() << " us; "
+        << (changed == tampered ? "matches" : "DOES NOT match") << " the tampered set.\n";
 }
 
 void Menu::visualizeTree() {
     if (!treeBuilt) { cout << "Build the tree first!\n"; return; }
-    if (!tree.root) { cout << "Tree root is null.\n"; return; }
+    if (tree.nodeCount == 0) { cout << "Tree root is null.\n"; return; }
 
     int maxLevels = 3;
     cout << "Enter how many levels to visualize (root = level 0). Enter 0 to only show root: ";
@@ -255,41 +625,38 @@ void Menu::visualizeTree() {
     dot << "digraph MerkleTree {\n";
     dot << "node [shape=box, style=filled, fontname=\"Courier\"];\n";
 
-    queue<pair<MerkleNode*, pair<string, int>>> q;
-    int id = 0;
-    string rootName = "node" + to_string(id++);
-    q.push({ tree.root, { rootName, 0 } });
+    // Nodes are (tree level, index within level); depth 0 is the root
+    size_t rootLevel = tree.levelCount - 1;
+    queue<pair<size_t, size_t>> q;
+    q.push({ rootLevel, 0 });
 
-    map<MerkleNode*, string> nodeNames;
-    nodeNames[tree.root] = rootName;
+    auto nodeName = [](size_t level, size_t index) {
+        return "n" + to_string(level) + "_" + to_string(index);
+    };
 
     while (!q.empty()) {
         auto pr = q.front(); q.pop();
-        MerkleNode* node = pr.first;
-        string name = pr.second.first;
-        int level = pr.second.second;
-        if (!node) continue;
+        size_t level = pr.first;
+        size_t index = pr.second;
+        string name = nodeName(level, index);
+        string hash = digest_to_hex(node_hash(tree, level, index));
 
         string color;
-        if (node == tree.root) color = "#FFD700";            
-        else if (!node->left && !node->right) color = "#98FB98"; 
-        else color = "#87CEEB";                              
+        if (level == rootLevel) color = "#FFD700";
+        else if (level == 0) color = "#98FB98";
+        else color = "#87CEEB";
 
-        string label = node->hash.substr(0, min<size_t>(16, node->hash.size())) + "...";
+        string label = hash.substr(0, min<size_t>(16, hash.size())) + "...";
         dot << name << " [label=\"" << label << "\", fillcolor=\"" << color << "\"];\n";
 
-        if (level < maxLevels) {
-            if (node->left) {
-                string leftName = nodeNames.count(node->left) ? nodeNames[node->left] : "node" + to_string(id++);
-                nodeNames[node->left] = leftName;
-                dot << name << " -> " << leftName << ";\n";
-                q.push({ node->left, { leftName, level + 1 } });
-            }
-            if (node->right) {
-                string rightName = nodeNames.count(node->right) ? nodeNames[node->right] : "node" + to_string(id++);
-                nodeNames[node->right] = rightName;
-                dot << name << " -> " << rightName << ";\n";
-                q.push({ node->right, { rightName, level + 1 } });
+        if (level > 0 && (int)(rootLevel - level) < maxLevels) {
+            size_t left = index * 2;
+            size_t right = left + 1;
+            dot << name << " -> " << nodeName(level - 1, left) << ";\n";
+            q.push({ level - 1, left });
+            if (right < level_size(tree, level - 1)) {
+                dot << name << " -> " << nodeName(level - 1, right) << ";\n";
+                q.push({ level - 1, right });
             }
         }
     }
@@ -305,7 +672,7 @@ void Menu::visualizeTree() {
 #endif
 }
 
-void Menu::visualizeProofTree(const string& leafHash, const vector<ProofStep>& proof, size_t proofLen) {
+void Menu::visualizeProofTree(const Digest& leafHash, const vector<ProofStep>& proof, size_t proofLen) {
     if (!treeBuilt || proofLen == 0) { cout << "Cannot visualize proof.\n"; return; }
 
     ofstream dot("merkle_proof_tree.dot");
@@ -316,14 +683,14 @@ void Menu::visualizeProofTree(const string& leafHash, const vector<ProofStep>& p
     dot << "node [shape=box, style=filled, fontname=\"Courier\"];\n";
 
     string prevNode = "leaf";
-    dot << prevNode << " [label=\"Leaf\\n" << leafHash.substr(0, 16)
+    dot << prevNode << " [label=\"Leaf\\n" << digest_to_hex(leafHash).substr(0, 16)
         << "...\", fillcolor=\"#FFA07A\"];\n";
 
     for (size_t i = 0; i < proofLen; i++) {
         string siblingNode = "s" + to_string(i);
         string parentNode = "p" + to_string(i);
 
-        dot << siblingNode << " [label=\"Sibling\\n" << proof[i].siblingHash.substr(0, 16)
+        dot << siblingNode << " [label=\"Sibling\\n" << digest_to_hex(proof[i].siblingHash).substr(0, 16)
             << "...\", fillcolor=\"#B0E0E6\"];\n";
         dot << parentNode << " [label=\"Parent " << i << "\", fillcolor=\"#87CEFA\"];\n";
 
@@ -341,7 +708,7 @@ void Menu::visualizeProofTree(const string& leafHash, const vector<ProofStep>& p
     }
 
     dot << prevNode << " -> root;\n";
-    dot << "root [label=\"Merkle Root\\n" << get_merkle_root(tree).substr(0, 16)
+    dot << "root [label=\"Merkle Root\\n" << digest_to_hex(get_merkle_root(tree)).substr(0, 16)
         << "...\", fillcolor=\"#90EE90\"];\n";
 
     dot << "}\n";
@@ -362,21 +729,251 @@ void Menu::runPerformanceTests() {
         return;
     }
 
+    cout << "Enter number of build threads (0 = all " << resolve_thread_count(0) << " cores): ";
+    unsigned threads;
+    if (cin >> threads) buildThreads = threads;
+    else cin.clear();
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
     size_t numTests = 20; 
-    cout << "Running advanced performance tests on Merkle tree with " << reviewIDs.size() << " reviews...\n";
+    cout << "Running advanced performance tests on Merkle tree with " << reviewIDs.size() << " reviews ("
+        << hash_mode_name(hashMode) << ")...\n";
 
     auto startBuild = std::chrono::high_resolution_clock::now();
     free_merkle_tree(tree);
-    init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size());
+    init_merkle_tree(tree, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
     auto endBuild = std::chrono::high_resolution_clock::now();
     treeBuilt = true;
+    startVersionHistory();
 
     double buildMs = std::chrono::duration<double, std::milli>(endBuild - startBuild).count();
 
-    double memMB = 0.0;
+    if (resolve_thread_count(buildThreads) > 1) {
+        MerkleTree serial;
+        auto startSerial = std::chrono::high_resolution_clock::now();
+        init_merkle_tree(serial, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, 1);
+        auto endSerial = std::chrono::high_resolution_clock::now();
+        double serialMs = std::chrono::duration<double, std::milli>(endSerial - startSerial).count();
+
+        cout << "Single-threaded build: " << std::fixed << std::setprecision(2) << serialMs << " ms, "
+            << resolve_thread_count(buildThreads) << " threads: " << buildMs << " ms (speedup "
+            << serialMs / buildMs << "x), roots "
+            << (get_merkle_root(serial) == get_merkle_root(tree) ? "identical" : "DIFFER") << "\n";
+        free_merkle_tree(serial);
+    }
+
+    size_t memBytes = merkle_tree_memory_bytes(tree);
+    double memMB = memBytes / (1024.0 * 1024.0);
 
     cout << "Merkle tree built in " << std::fixed << std::setprecision(2) << buildMs << " ms\n";
-    cout << "Approx memory used by tree: " << memMB << " MB\n\n";
+    cout << "Approx memory used by tree: " << memMB << " MB ("
+        << (double)memBytes / reviewIDs.size() << " bytes per leaf)\n";
+    cout << "Arena: " << tree.arena.allocations << " allocations served from " << tree.arena.blocks
+        << " blocks (" << tree.arena.bytesUsed / (1024.0 * 1024.0) << " MB used of "
+        << tree.arena.bytesReserved / (1024.0 * 1024.0) << " MB reserved)\n";
+
+    // Same build on huge pages, and the cost of tearing each tree down
+    {
+        MerkleTree huge;
+        huge.arena.hugePages = true;
+        auto start = std::chrono::high_resolution_clock::now();
+        init_merkle_tree(huge, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
+        double hugeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        size_t blocks = huge.arena.blocks, hugeBlocks = huge.arena.hugeBlocks;
+        size_t advisedBlocks = huge.arena.advisedBlocks;
+
+        start = std::chrono::high_resolution_clock::now();
+        free_merkle_tree(huge);
+        double freeMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        cout << "Huge-page build: " << hugeMs << " ms, " << hugeBlocks << " of " << blocks
+            << " blocks on 2 MB pages, " << advisedBlocks << " more advised to use them, freed in " << freeMs
+            << " ms\n\n";
+    }
+
+    // Selected hashing backend against picosha2 on every loaded review
+    {
+        size_t mismatches = 0;
+        for (size_t i = 0; i < reviewIDs.size(); i++) {
+            picosha2::hash256_one_by_one reference;
+            reference.process(reviewIDs[i].begin(), reviewIDs[i].end());
+            reference.process(reviewTexts[i].begin(), reviewTexts[i].end());
+            reference.finish();
+            Digest expected;
+            reference.get_hash_bytes(expected.begin(), expected.end());
+            if (hash_leaf(reviewIDs[i], reviewTexts[i]) != expected) mismatches++;
+        }
+        cout << "Hash backend: " << sha256_backend().name << ", " << mismatches
+            << " mismatches against picosha2 over " << reviewIDs.size() << " reviews\n";
+    }
+
+    // Leaf hashing throughput of each algorithm over the loaded reviews
+    {
+        size_t bytes = 0;
+        for (size_t i = 0; i < reviewIDs.size(); i++) bytes += reviewIDs[i].size() + reviewTexts[i].size();
+
+        cout << "Leaf hashing of " << bytes / (1024.0 * 1024.0) << " MB:";
+        for (HashMode mode : { HASH_MODE_BINARY, HASH_MODE_BLAKE3, HASH_MODE_XXH3_128 }) {
+            auto start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < reviewIDs.size(); i++) hash_leaf(reviewIDs[i], reviewTexts[i], mode);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            cout << " " << hash_mode_name(mode) << " " << ms << " ms ("
+                << bytes / (1024.0 * 1024.0) / (ms / 1000.0) << " MB/s)";
+        }
+        cout << "\n";
+    }
+
+    // SHA-256 microbenchmark on 64-byte internal-node messages
+    {
+        const size_t count = 200000;
+        vector<uint8_t> data(count * 64);
+        for (size_t i = 0; i < data.size(); i++) data[i] = (uint8_t)(i * 131 + 7);
+        vector<const uint8_t*> messages(count);
+        for (size_t i = 0; i < count; i++) messages[i] = data.data() + i * 64;
+        vector<Digest> reference(count), digests(count);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        for (size_t i = 0; i < count; i++)
+            picosha2::hash256(messages[i], messages[i] + 64, reference[i].begin(), reference[i].end());
+        double picoMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        cout << "SHA-256 of " << count << " 64-byte messages: picosha2 " << picoMs << " ms";
+
+        if (const Sha256Backend* shani = sha256_shani_backend()) {
+            start = std::chrono::high_resolution_clock::now();
+            for (size_t i = 0; i < count; i++) sha256_digest_with(*shani, messages[i], 64, digests[i]);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            cout << ", sha-ni " << ms << " ms (" << picoMs / ms << "x"
+                << (digests == reference ? "" : ", MISMATCH") << ")";
+        }
+
+        for (unsigned lanes : { 1u, 8u, 16u }) {
+            if (lanes > sha256_multi_lanes()) break;
+            start = std::chrono::high_resolution_clock::now();
+            sha256_multi(messages.data(), 64, count, digests.data(), lanes);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+            cout << ", " << lanes << "-lane " << ms << " ms (" << picoMs / ms << "x"
+                << (digests == reference ? "" : ", MISMATCH") << ")";
+        }
+        cout << "\n";
+    }
+
+    // Batched update: rewrite a random batch of reviews with their current text,
+    // which must leave the root unchanged
+    {
+        size_t batchSize = min<size_t>(reviewIDs.size(), 10000);
+        vector<pair<size_t, string>> batch;
+        batch.reserve(batchSize);
+        for (size_t k = 0; k < batchSize; k++) {
+            size_t idx = rand() % reviewIDs.size();
+            batch.push_back({ idx, reviewTexts[idx] });
+        }
+
+        Digest rootBefore = get_merkle_root(tree);
+        auto startBatch = std::chrono::high_resolution_clock::now();
+        UpdateStats stats = apply_updates(tree, batch.data(), batch.size(), buildThreads);
+        auto endBatch = std::chrono::high_resolution_clock::now();
+        double batchMs = std::chrono::duration<double, std::milli>(endBatch - startBatch).count();
+
+        cout << "Batched update of " << stats.leavesUpdated << " leaves: " << batchMs << " ms, "
+            << stats.hashesComputed << " hashes vs " << stats.sequentialHashes << " sequential ("
+            << stats.sequentialHashes - stats.hashesComputed << " saved), root "
+            << (get_merkle_root(tree) == rootBefore ? "unchanged" : "CHANGED") << "\n\n";
+    }
+
+    // 30 versions of 100 random edits each, on a scratch tree: only the
+    // copied paths cost memory
+    {
+        MerkleTree scratch;
+        init_merkle_tree(scratch, reviewIDs.data(), reviewTexts.data(), reviewIDs.size(), hashMode, buildThreads);
+        VersionStore history;
+        init_version_store(history, scratch);
+        size_t editsPerVersion = min<size_t>(reviewIDs.size(), 100);
+        size_t treeBytes = scratch.nodeCount * sizeof(Digest);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        vector<pair<size_t, string>> edits(editsPerVersion);
+        for (int v = 0; v < 30; v++) {
+            for (auto& edit : edits) {
+                edit.first = rand() % reviewIDs.size();
+                edit.second = to_string(v);
+            }
+            uint64_t id;
+            commit_version(history, scratch, edits.data(), edits.size(), id, buildThreads);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        size_t overlayBytes = version_store_memory_bytes(history);
+
+        size_t kept = history.liveNodes;
+        for (uint64_t id = 0; id < 30; id++) release_version(history, id);
+        cout << "30 versions x " << editsPerVersion << " edits: " << ms << " ms, " << kept << " overlay nodes ("
+            << overlayBytes / (1024.0 * 1024.0) << " MB vs " << 30 * (double)treeBytes / (1024.0 * 1024.0)
+            << " MB for full copies), " << history.liveNodes << " left after release\n\n";
+        free_version_store(history);
+        free_merkle_tree(scratch);
+    }
+
+    // Multi-proof for a clustered audit request versus independent proofs
+    {
+        size_t auditSize = min<size_t>(reviewIDs.size(), 1000);
+        size_t first = rand() % (reviewIDs.size() - auditSize + 1);
+        vector<size_t> audit;
+        for (size_t k = 0; k < auditSize; k++) audit.push_back(first + k);
+
+        size_t singleDigests = 0;
+        vector<ProofStep> proof(512);
+        for (size_t idx : audit) {
+            size_t proofLen = 0;
+            generate_proof_by_index(tree, idx, proof.data(), proofLen);
+            singleDigests += proofLen;
+        }
+
+        MultiProof multi;
+        generate_multiproof(tree, audit.data(), audit.size(), multi);
+        vector<Digest> auditLeaves;
+        for (size_t idx : multi.indices) auditLeaves.push_back(tree.nodes[idx]);
+
+        size_t multiHashes = 0;
+        auto startMulti = std::chrono::high_resolution_clock::now();
+        bool ok = verify_multiproof(multi, auditLeaves.data(), get_merkle_root(tree), tree.mode, &multiHashes);
+        auto endMulti = std::chrono::high_resolution_clock::now();
+
+        cout << "Multi-proof for " << auditSize << " clustered leaves: " << multi.siblings.size()
+            << " sibling digests vs " << singleDigests << " in single proofs, " << multiHashes
+            << " verify hashes vs " << singleDigests << ", verified in "
+            << std::chrono::duration<double, std::milli>(endMulti - startMulti).count() << " ms ("
+            << (ok ? "OK" : "FAILED") << ")\n\n";
+    }
+
+    // Batch verification; one leaf is corrupted so the bitmap must flag exactly one proof
+    {
+        size_t batchProofs = min<size_t>(reviewIDs.size(), 100000);
+        size_t stride = tree.levelCount;
+        vector<ProofStep> steps(batchProofs * stride);
+        vector<ProofCheck> checks(batchProofs);
+        Digest root = get_merkle_root(tree);
+
+        for (size_t k = 0; k < batchProofs; k++) {
+            size_t idx = rand() % reviewIDs.size();
+            checks[k].leafHash = tree.nodes[idx];
+            checks[k].proof = steps.data() + k * stride;
+            checks[k].rootHash = &root;
+            generate_proof_by_index(tree, idx, steps.data() + k * stride, checks[k].proofLen);
+        }
+        checks[0].leafHash[0] ^= 0xff;
+
+        vector<uint64_t> bits((batchProofs + 63) / 64);
+        auto startSeq = std::chrono::high_resolution_clock::now();
+        size_t passedSeq = verify_proofs_batch(checks.data(), checks.size(), bits.data(), tree.mode, 1);
+        auto endSeq = std::chrono::high_resolution_clock::now();
+        size_t passed = verify_proofs_batch(checks.data(), checks.size(), bits.data(), tree.mode, buildThreads);
+        auto endPar = std::chrono::high_resolution_clock::now();
+
+        double seqMs = std::chrono::duration<double, std::milli>(endSeq - startSeq).count();
+        double parMs = std::chrono::duration<double, std::milli>(endPar - endSeq).count();
+        cout << "Batch verification of " << batchProofs << " proofs: " << seqMs << " ms on 1 thread, "
+            << parMs << " ms on " << resolve_thread_count(buildThreads) << " ("
+            << batchProofs / (parMs / 1000.0) << " proofs/s), " << batchProofs - passed
+            << " failed (expected 1)" << (passed == passedSeq && (bits[0] & 1) == 0 ? "" : " MISMATCH") << "\n\n";
+    }
 
     cout << "Advanced Performance Results:\n";
     cout << "-----------------------------\n";
@@ -391,7 +988,7 @@ void Menu::runPerformanceTests() {
 
         for (size_t t = 0; t < numTests; t++) {
             size_t idx = rand() % reviewIDs.size();
-            string leafHash = picosha2::hash256_hex_string(reviewIDs[idx] + reviewTexts[idx]);
+            Digest leafHash = hash_leaf(reviewIDs[idx], reviewTexts[idx], tree.mode);
 
             vector<ProofStep> proof(512);
             size_t proofLen = 0;
@@ -407,7 +1004,7 @@ void Menu::runPerformanceTests() {
             totalGenMs += genMs;
 
             auto startVer = std::chrono::high_resolution_clock::now();
-            bool ok = verify_proof(leafHash, proof.data(), proofLen, get_merkle_root(tree));
+            bool ok = verify_proof(leafHash, proof.data(), proofLen, get_merkle_root(tree), tree.mode);
             auto endVer = std::chrono::high_resolution_clock::now();
             double verMs = std::chrono::duration<double, std::milli>(endVer - startVer).count();
             totalVerMs += verMs;
@@ -435,3 +1032,186 @@ void Menu::runPerformanceTests() {
     }
 }
 
+void Menu::generateConsistencyProof() {
+    if (!treeBuilt) { cout << "Build the tree first!\n"; return; }
+
+    cout << "Earlier tree size (1-" << tree.leafCount << "): ";
+    size_t oldSize;
+    if (!(cin >> oldSize) || oldSize == 0 || oldSize > tree.leafCount) {
+        cout << "Invalid size.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    cout << "Root published at that size (blank = recompute from the first " << oldSize << " leaves): ";
+    string hex;
+    getline(cin, hex);
+    Digest oldRoot;
+    if (hex.empty()) oldRoot = compute_root(tree.nodes, oldSize, tree.mode);
+    else if (!hex_to_digest(hex, oldRoot)) { cout << "Invalid root hash.\n"; return; }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    vector<Digest> proof;
+    generate_consistency_proof(tree, oldSize, proof);
+    auto end = std::chrono::high_resolution_clock::now();
+    bool ok = verify_consistency_proof(oldRoot, oldSize, get_merkle_root(tree), tree.leafCount, proof, tree.mode);
+
+    cout << "Consistency proof " << oldSize << " -> " << tree.leafCount << ": " << proof.size() << " digests, generated in "
+        << std::chrono::duration<double, std::micro>(end - start).count() << " us\n";
+    for (const Digest& digest : proof)
+        cout << "  " << digest_to_hex(digest) << "\n";
+    cout << "Verification result: " << (ok ? "CONSISTENT" : "NOT CONSISTENT") << "\n";
+}
+
+void Menu::buildBoundedTree() {
+    string filename;
+    size_t budgetKB;
+    cout << "Enter dataset filename: ";
+    if (!(cin >> filename)) {
+        cout << "Invalid filename input.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    cout << "Memory budget for resident levels (KB): ";
+    if (!(cin >> budgetKB)) {
+        cout << "Invalid budget.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+
+    BoundedMerkleTree bounded;
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!build_bounded_tree_from_file(bounded, filename, budgetKB * 1024, hashMode)) {
+        cout << "Could not read any reviews from " << filename << "\n";
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    size_t fullBytes = (2 * bounded.leafCount - 1) * sizeof(Digest);
+    cout << "Built over " << bounded.leafCount << " reviews in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+        << hash_mode_name(bounded.mode) << ")\n";
+    cout << "Resident from level " << bounded.residentLevel << " (chunks of " << ((size_t)1 << bounded.residentLevel)
+        << " leaves): " << bounded_tree_memory_bytes(bounded) / 1024.0 << " KB vs "
+        << fullBytes / 1024.0 << " KB for the full node array\n";
+    cout << "Root hash: " << digest_to_hex(bounded_root(bounded)) << "\n";
+
+    cout << "Leaf index to prove: ";
+    size_t index;
+    if (!(cin >> index)) {
+        cout << "Invalid index.\n";
+        cin.clear();
+        cin.ignore(numeric_limits<streamsize>::max(), '\n');
+        return;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+
+    ProofStep proof[64];
+    size_t proofLen = 0;
+    start = std::chrono::high_resolution_clock::now();
+    Digest leafHash;
+    bool generated = bounded_generate_proof(bounded, index, proof, proofLen, &leafHash);
+    end = std::chrono::high_resolution_clock::now();
+    if (!generated) {
+        cout << "Could not generate a proof (index out of range, or the file changed since the build).\n";
+        return;
+    }
+
+    bool ok = verify_proof(leafHash, proof, proofLen, bounded_root(bounded), bounded.mode);
+    cout << "Proof of " << proofLen << " steps after rehashing " << bounded.leavesRehashed << " leaves in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms\n";
+    cout << "Verification result: " << (ok ? "NO TAMPERING DETECTED" : "TAMPERING DETECTED") << "\n";
+}
+
+void Menu::buildExternalTree() {
+    string filename, dir;
+    cout << "Enter dataset filename: ";
+    if (!(cin >> filename)) {
+        cout << "Invalid filename input.\n";
+        return;
+    }
+    cin.ignore(numeric_limits<streamsize>::max(), '\n');
+    cout << "Directory for level files (blank = current): ";
+    getline(cin, dir);
+    if (dir.empty()) dir = ".";
+
+    ExternalTreeBuilder builder;
+    if (!init_external_builder(builder, dir, hashMode, (size_t)1 << 20, buildThreads)) {
+        cout << "Could not create level files in " << dir << "\n";
+        return;
+    }
+
+    // Leaves are hashed a batch at a time
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t batch = 8192;
+    vector<string> ids, texts;
+    bool opened = scan_review_file(filename, [&](string& id, string& text) {
+        ids.push_back(move(id));
+        texts.push_back(move(text));
+        if (ids.size() == batch) {
+            external_append_chunk(builder, ids.data(), texts.data(), ids.size());
+            ids.clear();
+            texts.clear();
+        }
+    });
+    external_append_chunk(builder, ids.data(), texts.data(), ids.size());
+
+    Digest root;
+    bool ok = finish_external_build(builder, root);
+    if (!opened) {
+        cout << "Could not open dataset file: " << filename << "\n";
+        return;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    if (!ok) {
+        cout << "External build failed (no reviews, or a level file could not be written).\n";
+        return;
+    }
+
+    cout << "Built " << builder.levelCount << " levels over " << builder.leafCount << " reviews in "
+        << std::chrono::duration<double, std::milli>(end - start).count() << " ms ("
+        << hash_mode_name(builder.mode) << ")\n";
+    cout << "Level files: " << builder.bytesWritten / (1024.0 * 1024.0) << " MB written, "
+        << builder.bytesRead / (1024.0 * 1024.0) << " MB read back through 2.5 MB of buffers\n";
+    cout << "Root hash: " << digest_to_hex(root) << "\n";
+}
+
+// ===== Load and Build in One Pass =====
+// Parsing, leaf hashing and tree building overlap instead of running one
+// after the other; the result is the same as options 1 and 2
+void Menu::loadAndBuild() {
+    string filename;
+    cout << "Enter dataset filename: ";
+    if (!(cin >> filename)) {
+        cout << "Invalid filename input.\n";
+        return;
+    }
+
+    vector<string> ids, texts;
+    PipelineStats stats;
+    if (!load_and_build(filename, ids, texts, tree, hashMode, buildThreads, &stats)) {
+        cout << "Could not open dataset file: " << filename << "\n";
+        return;
+    }
+
+    reviewIDs.swap(ids);
+    reviewTexts.swap(texts);
+    sparseBuilt = false;
+    treeBuilt = !reviewIDs.empty();
+    startVersionHistory();
+    if (!treeBuilt) {
+        cout << "No reviews found in " << filename << "\n";
+        return;
+    }
+
+    cout << "Loaded and built " << stats.records << " reviews in " << stats.timeToRootMs << " ms ("
+        << hash_mode_name(tree.mode) << ", " << stats.hashWorkers << " hash workers)\n";
+    cout << "Reader busy " << stats.readMs << " ms; " << stats.batches << " batches, reader stalled "
+        << stats.readerStalls << " times on full queues, builder waited " << stats.builderWaits << " times\n";
+    cout << "Root hash: " << digest_to_hex(get_merkle_root(tree)) << "\n";
+}
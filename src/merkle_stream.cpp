@@ -0,0 +1,40 @@
+#include "merkle_stream.h"
+
+void init_merkle_stream(MerkleStream& stream, HashMode mode) {
+    stream.leafCount = 0;
+    stream.mode = mode;
+}
+
+// Binary-counter carry: merge equal-sized subtrees until a free slot is found
+void stream_append_leaf(MerkleStream& stream, const Digest& leaf) {
+    Digest carry = leaf;
+    size_t k = 0;
+    while (stream.leafCount & ((uint64_t)1 << k)) {
+        hash_node(stream.frontier[k], carry, carry, stream.mode);
+        k++;
+    }
+    stream.frontier[k] = carry;
+    stream.leafCount++;
+}
+
+void stream_append(MerkleStream& stream, const string& reviewID, const string& reviewText) {
+    stream_append_leaf(stream, hash_leaf(reviewID, reviewText, stream.mode));
+}
+
+void stream_append_chunk(MerkleStream& stream, const string* reviewIDs, const string* reviewTexts, size_t n) {
+    for (size_t i = 0; i < n; i++)
+        stream_append_leaf(stream, hash_leaf(reviewIDs[i], reviewTexts[i], stream.mode));
+}
+
+Digest stream_root(const MerkleStream& stream) {
+    if (stream.leafCount == 0) return Digest{};
+
+    size_t k = 0;
+    while (!(stream.leafCount & ((uint64_t)1 << k))) k++;
+
+    Digest root = stream.frontier[k];
+    for (k++; k < 64; k++)
+        if (stream.leafCount & ((uint64_t)1 << k))
+            hash_node(stream.frontier[k], root, root, stream.mode);
+    return root;
+}
@@ -1,118 +1,604 @@
 #include "merkle_tree.h"
+#include "parallel.h"
+#include "tree_image.h"
+#include <algorithm>
+#include <cstring>
 #include <functional>
+#include <thread>
+#include <vector>
 
-// Recursive tree builder
-MerkleNode* build_tree(MerkleNode** nodes, size_t count) {
-    if (count == 0) return nullptr;
-    if (count == 1) return nodes[0];
-
-    size_t parentCount = (count + 1) / 2;
-    MerkleNode** parents = new MerkleNode * [parentCount];
-
-    for (size_t i = 0, j = 0; i < count; i += 2, j++) {
-        MerkleNode* parent = new MerkleNode;
-        parent->left = nodes[i];
-        nodes[i]->parent = parent;
-
-        if (i + 1 < count) {
-            parent->right = nodes[i + 1];
-            nodes[i + 1]->parent = parent;
-            parent->hash = picosha2::hash256_hex_string(
-                parent->left->hash + parent->right->hash
-            );
-        }
-        else {
-            parent->right = nullptr;
-            parent->hash = parent->left->hash;
-        }
+static const char HEX_DIGITS[] = "0123456789abcdef";
 
-        parents[j] = parent;
+string digest_to_hex(const Digest& digest) {
+    string hex(64, '0');
+    for (size_t i = 0; i < digest.size(); i++) {
+        hex[2 * i] = HEX_DIGITS[digest[i] >> 4];
+        hex[2 * i + 1] = HEX_DIGITS[digest[i] & 0x0f];
     }
+    return hex;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+bool hex_to_digest(const string& hex, Digest& digest) {
+    if (hex.size() != 64) return false;
+    for (size_t i = 0; i < digest.size(); i++) {
+        int hi = hex_value(hex[2 * i]);
+        int lo = hex_value(hex[2 * i + 1]);
+        if (hi < 0 || lo < 0) return false;
+        digest[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+// ID and text are fed to the hash one after the other, never joined
+template <typename Policy>
+static Digest policy_hash_leaf(string_view reviewID, string_view reviewText) {
+    Digest out;
+    Policy::hash_concat((const uint8_t*)reviewID.data(), reviewID.size(), (const uint8_t*)reviewText.data(),
+        reviewText.size(), out);
+    return out;
+}
+
+Digest hash_leaf(string_view reviewID, string_view reviewText, HashMode mode) {
+    return with_hash_policy(mode, [&](auto policy) {
+        return policy_hash_leaf<decltype(policy)>(reviewID, reviewText);
+    });
+}
+
+void hash_node(const Digest& left, const Digest& right, Digest& out, HashMode mode) {
+    with_hash_policy(mode, [&](auto policy) { decltype(policy)::hash_node(left, right, out); });
+}
+
+size_t level_size(const MerkleTree& tree, size_t level) {
+    if (level >= tree.levelCount) return 0;
+    return (tree.leafCount + ((size_t)1 << level) - 1) >> level;
+}
 
-    MerkleNode* root = build_tree(parents, parentCount);
-    delete[] parents;
-    return root;
+const Digest& node_hash(const MerkleTree& tree, size_t level, size_t index) {
+    return tree.nodes[tree.levelOffsets[level] + index];
+}
+
+// Hash parents [first, last) of one level from the level below
+template <typename Policy>
+static void build_level_range(MerkleTree& tree, size_t level, size_t first, size_t last) {
+    const Digest* children = tree.nodes + tree.levelOffsets[level - 1];
+    Digest* parents = tree.nodes + tree.levelOffsets[level];
+    size_t childCount = level_size(tree, level - 1);
+
+    // Only the last parent of a level can be a promoted odd child
+    size_t paired = min(last, childCount / 2);
+    if (paired > first)
+        Policy::hash_pairs(children + 2 * first, paired - first, parents + first);
+    for (size_t j = max(first, paired); j < last; j++)
+        parents[j] = children[2 * j];
+}
+
+// Each worker owns aligned blocks of 2^splitLevel leaves and builds their
+// subtrees (leaf hashing included) up to splitLevel without synchronizing;
+// the few nodes above splitLevel are then joined on the calling thread.
+// Every node is hashed from the same children as in the serial order, so
+// the root is bit-identical for any thread count.
+template <typename Policy>
+static void build_subtrees(MerkleTree& tree, unsigned threads,
+    const function<void(size_t, size_t)>& hashLeaves) {
+    size_t workers = resolve_thread_count(threads);
+
+    size_t splitLevel = 0;
+    if (workers > 1)
+        while (splitLevel + 1 < tree.levelCount && ((size_t)1 << splitLevel) * workers < tree.leafCount)
+            splitLevel++;
+
+    size_t blockCount = level_size(tree, splitLevel);
+    parallel_for(blockCount, (unsigned)workers, [&](size_t b0, size_t b1) {
+        hashLeaves(b0 << splitLevel, min(b1 << splitLevel, tree.leafCount));
+        for (size_t level = 1; level <= splitLevel; level++) {
+            size_t shift = splitLevel - level;
+            build_level_range<Policy>(tree, level, b0 << shift, min(b1 << shift, level_size(tree, level)));
+        }
+    });
+
+    for (size_t level = splitLevel + 1; level < tree.levelCount; level++)
+        build_level_range<Policy>(tree, level, 0, level_size(tree, level));
+}
+
+// Rebuild every internal level from the current leaves
+void build_tree(MerkleTree& tree, unsigned threads) {
+    if (tree.nodeCount == 0) return;
+    with_hash_policy(tree.mode, [&](auto policy) {
+        build_subtrees<decltype(policy)>(tree, threads, [](size_t, size_t) {});
+    });
 }
 
 // Initialize tree
-void init_merkle_tree(MerkleTree& tree, string* reviewIDs, string* reviewTexts, size_t n) {
+void init_merkle_tree(MerkleTree& tree, string* reviewIDs, string* reviewTexts, size_t n, HashMode mode,
+    unsigned threads) {
+    with_hash_policy(mode, [&](auto policy) {
+        init_merkle_tree<decltype(policy)>(tree, reviewIDs, reviewTexts, n, threads);
+    });
+}
+
+// Level table and node array for n leaves
+static void layout_tree(MerkleTree& tree, size_t n) {
+    tree.levelCount = 1;
+    for (size_t count = n; count > 1; count = (count + 1) / 2)
+        tree.levelCount++;
+
+    tree.levelOffsets = arena_new_array<size_t>(tree.arena, tree.levelCount);
+    tree.nodeCount = 0;
+    for (size_t level = 0; level < tree.levelCount; level++) {
+        tree.levelOffsets[level] = tree.nodeCount;
+        tree.nodeCount += level_size(tree, level);
+    }
+
+    // Cache-line aligned so sibling pairs never straddle two lines
+    tree.nodes = (Digest*)arena_alloc(tree.arena, tree.nodeCount * sizeof(Digest), 64);
+}
+
+static void index_leaves(MerkleTree& tree) {
+    tree.leafIndex.reserve(tree.leafCount);
+    for (size_t i = 0; i < tree.leafCount; i++)
+        tree.leafIndex.emplace(tree.nodes[i], i);
+}
+
+template <typename Policy>
+void init_merkle_tree(MerkleTree& tree, string* reviewIDs, string* reviewTexts, size_t n, unsigned threads) {
     tree.leafCount = n;
-    tree.leaves = new MerkleNode * [n];
+    tree.mode = Policy::mode;
+    if (n == 0) return;
+    layout_tree(tree, n);
+
+    // The ID index only needs the IDs, so fill it while the workers hash
+    auto buildIdIndex = [&]() {
+        tree.idIndex.reserve(n);
+        tree.leafIds.resize(n);
+        for (size_t i = 0; i < n; i++)
+            tree.leafIds[i] = &tree.idIndex.emplace(reviewIDs[i], i)->first;
+    };
+    thread idIndexer;
+    if (resolve_thread_count(threads) > 1) idIndexer = thread(buildIdIndex);
 
-    for (size_t i = 0; i < n; i++) {
-        tree.leaves[i] = new MerkleNode;
-        tree.leaves[i]->hash = picosha2::hash256_hex_string(reviewIDs[i] + reviewTexts[i]);
+    build_subtrees<Policy>(tree, threads, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++)
+            tree.nodes[i] = policy_hash_leaf<Policy>(reviewIDs[i], reviewTexts[i]);
+    });
+
+    if (idIndexer.joinable()) idIndexer.join();
+    else buildIdIndex();
+    index_leaves(tree);
+}
+
+void reserve_merkle_tree(MerkleTree& tree, size_t capacity, HashMode mode) {
+    tree.leafCount = capacity;
+    tree.mode = mode;
+    if (capacity > 0) layout_tree(tree, capacity);
+}
+
+void finish_reserved_tree(MerkleTree& tree, size_t n, string* reviewIDs) {
+    if (n == 0) {
+        free_merkle_tree(tree);
+        return;
+    }
+
+    // Each level moves down to its offset for n leaves. No level grows, so
+    // a destination never reaches a level that has not moved yet.
+    tree.leafCount = n;
+    size_t offset = 0, levels = 0;
+    for (size_t count = n;; count = (count + 1) / 2) {
+        memmove(tree.nodes + offset, tree.nodes + tree.levelOffsets[levels], count * sizeof(Digest));
+        tree.levelOffsets[levels++] = offset;
+        offset += count;
+        if (count == 1) break;
     }
+    tree.levelCount = levels;
+    tree.nodeCount = offset;
 
-    tree.root = build_tree(tree.leaves, n);
+    tree.idIndex.reserve(n);
+    tree.leafIds.resize(n);
+    for (size_t i = 0; i < n; i++)
+        tree.leafIds[i] = &tree.idIndex.emplace(reviewIDs[i], i)->first;
+    index_leaves(tree);
 }
 
-// Free memory
+void copy_tree_nodes(const MerkleTree& from, MerkleTree& to) {
+    free_merkle_tree(to);
+    to.leafCount = from.leafCount;
+    to.mode = from.mode;
+    if (from.nodeCount == 0) return;
+    layout_tree(to, from.leafCount);
+    memcpy(to.nodes, from.nodes, from.nodeCount * sizeof(Digest));
+}
+
+// Free memory. The indexes are swapped for empty ones first so nothing
+// keeps a bucket array inside the released arena.
 void free_merkle_tree(MerkleTree& tree) {
-    function<void(MerkleNode*)> free_node = [&](MerkleNode* node) {
-        if (!node) return;
-        free_node(node->left);
-        free_node(node->right);
-        delete node;
-        };
+    {
+        MerkleTree::LeafIndex emptyLeaves(tree.leafIndex.get_allocator());
+        MerkleTree::IdIndex emptyIds(tree.idIndex.get_allocator());
+        tree.leafIndex.swap(emptyLeaves);
+        tree.idIndex.swap(emptyIds);
+    }
+    close_tree_image(tree);
+    arena_release(tree.arena);
+    tree.nodes = nullptr;
+    tree.levelOffsets = nullptr;
+    tree.levelCount = 0;
+    tree.leafCount = 0;
+    tree.nodeCount = 0;
+    tree.leafIds.clear();
+}
 
-    free_node(tree.root);
+Digest get_merkle_root(const MerkleTree& tree) {
+    return tree.nodeCount ? tree.nodes[tree.nodeCount - 1] : Digest{};
+}
 
-    delete[] tree.leaves;
-    tree.leaves = nullptr;
-    tree.leafCount = 0;
-    tree.root = nullptr;
+Digest compute_root(const Digest* leaves, size_t n, HashMode mode) {
+    return with_hash_policy(mode, [&](auto policy) { return compute_root<decltype(policy)>(leaves, n); });
 }
 
-string get_merkle_root(MerkleTree& tree) {
-    return tree.root ? tree.root->hash : "";
+template <typename Policy>
+Digest compute_root(const Digest* leaves, size_t n) {
+    if (n == 0) return Digest{};
+
+    vector<Digest> level(leaves, leaves + n);
+    while (level.size() > 1) {
+        size_t parentCount = (level.size() + 1) / 2;
+        for (size_t i = 0, j = 0; i < level.size(); i += 2, j++) {
+            if (i + 1 < level.size())
+                Policy::hash_node(level[i], level[i + 1], level[j]);
+            else
+                level[j] = level[i];
+        }
+        level.resize(parentCount);
+    }
+    return level[0];
 }
 
-// Generate Merkle Proof
-bool generate_proof(MerkleTree& tree, const string& leafHash, ProofStep proof[], size_t& proofLen) {
-    MerkleNode* leaf = nullptr;
+#define INSTANTIATE_POLICY(Policy) \
+    template void init_merkle_tree<Policy>(MerkleTree&, string*, string*, size_t, unsigned); \
+    template Digest compute_root<Policy>(const Digest*, size_t);
+
+INSTANTIATE_POLICY(Sha256HexPolicy)
+INSTANTIATE_POLICY(Sha256Policy)
+INSTANTIATE_POLICY(Blake3Policy)
+INSTANTIATE_POLICY(Xxh3Policy)
+
+// Heap buffer behind a string; none while its characters sit in the
+// object's own small-string storage, whatever size the library allows there
+static size_t string_heap_bytes(const string& s) {
+    uintptr_t data = (uintptr_t)s.data();
+    uintptr_t object = (uintptr_t)&s;
+    bool inlineChars = data >= object && data < object + sizeof(string);
+    return inlineChars ? 0 : s.capacity() + 1;
+}
+
+// Arena blocks (nodes, level table, index buckets and entries), plus the
+// leaf ID table and the heap buffers of IDs too long for inline storage
+size_t merkle_tree_memory_bytes(const MerkleTree& tree) {
+    size_t bytes = tree.arena.bytesReserved;
+
+    bytes += tree.leafIds.capacity() * sizeof(const string*);
+    for (const auto& entry : tree.idIndex) bytes += string_heap_bytes(entry.first);
+    return bytes;
+}
+
+// Lowest position stored under a key, so duplicates resolve deterministically
+template <typename Index, typename Key>
+static bool lowest_position(const Index& idx, const Key& key, size_t& index) {
+    auto range = idx.equal_range(key);
+    if (range.first == range.second) return false;
+
+    index = range.first->second;
+    for (auto it = range.first; it != range.second; ++it)
+        if (it->second < index) index = it->second;
+    return true;
+}
 
-    for (size_t i = 0; i < tree.leafCount; i++) {
-        if (tree.leaves[i]->hash == leafHash) {
-            leaf = tree.leaves[i];
-            break;
+// Re-key the entry for one position, leaving duplicates of the old key
+// alone. The node is moved rather than reallocated, so updates never grow
+// the arena.
+template <typename Index, typename Key>
+static typename Index::iterator rekey_position(Index& idx, const Key& oldKey, const Key& newKey, size_t index) {
+    auto range = idx.equal_range(oldKey);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == index) {
+            auto node = idx.extract(it);
+            node.key() = newKey;
+            return idx.insert(move(node));
         }
     }
+    return idx.emplace(newKey, index);
+}
 
-    if (!leaf) return false;
+bool find_leaf_by_hash(const MerkleTree& tree, const Digest& leafHash, size_t& index) {
+    return lowest_position(tree.leafIndex, leafHash, index);
+}
 
-    proofLen = 0;
-    MerkleNode* current = leaf;
+bool find_leaf_by_id(const MerkleTree& tree, const string& reviewID, size_t& index) {
+    return lowest_position(tree.idIndex, reviewID, index);
+}
 
-    while (current->parent) {
-        MerkleNode* parent = current->parent;
+bool update_leaf(MerkleTree& tree, size_t index, const string& newId, const string& newText) {
+    if (index >= tree.leafCount) return false;
 
-        if (parent->left == current && parent->right) {
-            proof[proofLen].siblingHash = parent->right->hash;
-            proof[proofLen].isLeft = false;
+    Digest leaf = hash_leaf(newId, newText, tree.mode);
+
+    // Trees opened from an image carry no indexes
+    if (!tree.leafIds.empty()) {
+        rekey_position(tree.leafIndex, tree.nodes[index], leaf, index);
+        if (*tree.leafIds[index] != newId) {
+            string oldId = *tree.leafIds[index];
+            tree.leafIds[index] = &rekey_position(tree.idIndex, oldId, newId, index)->first;
         }
-        else if (parent->right == current && parent->left) {
-            proof[proofLen].siblingHash = parent->left->hash;
-            proof[proofLen].isLeft = true;
+    }
+
+    tree.nodes[index] = leaf;
+    with_hash_policy(tree.mode, [&](auto policy) {
+        for (size_t level = 1; level < tree.levelCount; level++) {
+            index /= 2;
+            build_level_range<decltype(policy)>(tree, level, index, index + 1);
         }
+    });
+    return true;
+}
+
+// Hashes one update_leaf() call performs: the leaf plus every paired ancestor
+static size_t path_hash_count(const MerkleTree& tree, size_t index) {
+    size_t hashes = 1;
+    for (size_t level = 1; level < tree.levelCount; level++, index /= 2)
+        if ((index | 1) < level_size(tree, level - 1)) hashes++;
+    return hashes;
+}
+
+UpdateStats apply_updates(MerkleTree& tree, const pair<size_t, string>* updates, size_t count,
+    unsigned threads) {
+    UpdateStats stats;
+    if (tree.leafIds.empty()) return stats;
 
+    vector<Digest> newLeaves(count);
+    parallel_for(count, threads, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; k++)
+            if (updates[k].first < tree.leafCount)
+                newLeaves[k] = hash_leaf(*tree.leafIds[updates[k].first], updates[k].second, tree.mode);
+    });
+
+    vector<size_t> dirty;
+    dirty.reserve(count);
+    for (size_t k = 0; k < count; k++) {
+        size_t index = updates[k].first;
+        if (index >= tree.leafCount) continue;
+
+        if (!tree.leafIndex.empty()) rekey_position(tree.leafIndex, tree.nodes[index], newLeaves[k], index);
+        tree.nodes[index] = newLeaves[k];
+
+        dirty.push_back(index);
+        stats.leavesUpdated++;
+        stats.hashesComputed++;
+        stats.sequentialHashes += path_hash_count(tree, index);
+    }
+
+    sort(dirty.begin(), dirty.end());
+    dirty.erase(unique(dirty.begin(), dirty.end()), dirty.end());
+
+    for (size_t level = 1; level < tree.levelCount && !dirty.empty(); level++) {
+        // Sorted children map to sorted parents, so adjacent duplicates are all there is
+        size_t parents = 0;
+        for (size_t k = 0; k < dirty.size(); k++) {
+            size_t parent = dirty[k] / 2;
+            if (parents == 0 || dirty[parents - 1] != parent) dirty[parents++] = parent;
+        }
+        dirty.resize(parents);
+
+        // Upper levels shrink quickly; not worth spawning workers for a handful of nodes
+        unsigned levelThreads = dirty.size() >= 4096 ? threads : 1;
+        with_hash_policy(tree.mode, [&](auto policy) {
+            parallel_for(dirty.size(), levelThreads, [&](size_t first, size_t last) {
+                for (size_t k = first; k < last; k++)
+                    build_level_range<decltype(policy)>(tree, level, dirty[k], dirty[k] + 1);
+            });
+        });
+
+        size_t childCount = level_size(tree, level - 1);
+        for (size_t parent : dirty)
+            if (2 * parent + 1 < childCount) stats.hashesComputed++;
+    }
+
+    return stats;
+}
+
+// Generate Merkle Proof
+bool generate_proof(MerkleTree& tree, const Digest& leafHash, ProofStep proof[], size_t& proofLen) {
+    size_t index;
+    if (!find_leaf_by_hash(tree, leafHash, index)) return false;
+    return generate_proof_by_index(tree, index, proof, proofLen);
+}
+
+bool generate_proof_by_index(MerkleTree& tree, size_t index, ProofStep proof[], size_t& proofLen) {
+    if (index >= tree.leafCount) return false;
+
+    proofLen = 0;
+    for (size_t level = 0; level + 1 < tree.levelCount; level++, index /= 2) {
+        size_t sibling = index ^ 1;
+        if (sibling >= level_size(tree, level)) continue; // promoted, no sibling
+
+        proof[proofLen].siblingHash = node_hash(tree, level, sibling);
+        proof[proofLen].isLeft = (index & 1) != 0;
         proofLen++;
-        current = parent;
     }
 
     return true;
 }
 
-// Verify Merkle Proof
-bool verify_proof(const string& leafHash, ProofStep proof[], size_t proofLen, const string& rootHash) {
-    string hash = leafHash;
+bool diff_trees(const MerkleTree& a, const MerkleTree& b, vector<size_t>& differing, size_t* nodesCompared) {
+    differing.clear();
+    if (a.leafCount != b.leafCount || a.mode != b.mode) return false;
+    if (a.leafCount == 0) {
+        if (nodesCompared) *nodesCompared = 0;
+        return true;
+    }
+
+    // Mismatching positions of the current level, kept sorted as children
+    // are generated left to right
+    size_t compared = 1;
+    size_t top = a.levelCount - 1;
+    if (node_hash(a, top, 0) != node_hash(b, top, 0)) differing.push_back(0);
+
+    vector<size_t> children;
+    for (size_t level = top; level > 0 && !differing.empty(); level--) {
+        size_t childCount = level_size(a, level - 1);
+        children.clear();
+        for (size_t pos : differing) {
+            for (size_t child = 2 * pos; child < min(2 * pos + 2, childCount); child++) {
+                compared++;
+                if (node_hash(a, level - 1, child) != node_hash(b, level - 1, child)) children.push_back(child);
+            }
+        }
+        differing.swap(children);
+    }
+
+    if (nodesCompared) *nodesCompared = compared;
+    return true;
+}
+
+// Walk a multi-proof layout from the leaves to the root. positions must be
+// sorted and unique. sibling(level, pos, digest) supplies a digest the walk
+// cannot derive and returns false if none is available. When hashes is
+// non-null it runs alongside positions and is folded into the root.
+template <typename SiblingFn>
+static bool walk_multiproof(size_t leafCount, vector<size_t>& positions, vector<Digest>* hashes,
+    HashMode mode, size_t& hashCount, SiblingFn sibling) {
+    Digest siblingHash;
+    size_t levelSize = leafCount;
+
+    for (size_t level = 0; levelSize > 1; level++) {
+        size_t out = 0;
+        for (size_t k = 0; k < positions.size(); k++) {
+            size_t pos = positions[k];
+            Digest parent;
+
+            if ((pos & 1) == 0 && k + 1 < positions.size() && positions[k + 1] == pos + 1) {
+                if (hashes) hash_node((*hashes)[k], (*hashes)[k + 1], parent, mode);
+                hashCount++;
+                k++;
+            }
+            else if ((pos ^ 1) >= levelSize) {
+                if (hashes) parent = (*hashes)[k]; // promoted
+            }
+            else {
+                if (!sibling(level, pos ^ 1, siblingHash)) return false;
+                if (hashes) {
+                    if (pos & 1) hash_node(siblingHash, (*hashes)[k], parent, mode);
+                    else hash_node((*hashes)[k], siblingHash, parent, mode);
+                }
+                hashCount++;
+            }
+
+            positions[out] = pos / 2;
+            if (hashes) (*hashes)[out] = parent;
+            out++;
+        }
+        positions.resize(out);
+        if (hashes) hashes->resize(out);
+        levelSize = (levelSize + 1) / 2;
+    }
+    return true;
+}
+
+bool generate_multiproof(const MerkleTree& tree, const size_t* indices, size_t count, MultiProof& proof) {
+    proof.leafCount = tree.leafCount;
+    proof.indices.assign(indices, indices + count);
+    proof.siblings.clear();
+
+    sort(proof.indices.begin(), proof.indices.end());
+    proof.indices.erase(unique(proof.indices.begin(), proof.indices.end()), proof.indices.end());
+    if (proof.indices.empty() || proof.indices.back() >= tree.leafCount) return false;
+
+    vector<size_t> positions = proof.indices;
+    size_t hashCount = 0;
+    return walk_multiproof(tree.leafCount, positions, nullptr, tree.mode, hashCount,
+        [&](size_t level, size_t pos, Digest&) {
+            proof.siblings.push_back(node_hash(tree, level, pos));
+            return true;
+        });
+}
+
+bool verify_multiproof(const MultiProof& proof, const Digest* leafHashes, const Digest& rootHash,
+    HashMode mode, size_t* hashesComputed) {
+    if (proof.indices.empty()) return false;
+    for (size_t k = 0; k < proof.indices.size(); k++)
+        if (proof.indices[k] >= proof.leafCount || (k > 0 && proof.indices[k] <= proof.indices[k - 1]))
+            return false;
+
+    vector<size_t> positions = proof.indices;
+    vector<Digest> hashes(leafHashes, leafHashes + proof.indices.size());
+    size_t next = 0, hashCount = 0;
+
+    bool ok = walk_multiproof(proof.leafCount, positions, &hashes, mode, hashCount,
+        [&](size_t, size_t, Digest& digest) {
+            if (next >= proof.siblings.size()) return false;
+            digest = proof.siblings[next++];
+            return true;
+        });
+
+    if (hashesComputed) *hashesComputed = hashCount;
+    return ok && next == proof.siblings.size() && hashes[0] == rootHash;
+}
+
+// Fold a proof path into the digest it commits to
+template <typename Policy>
+static Digest fold_proof(const Digest& leafHash, const ProofStep* proof, size_t proofLen) {
+    Digest hash = leafHash;
 
     for (size_t i = 0; i < proofLen; i++) {
         if (proof[i].isLeft)
-            hash = picosha2::hash256_hex_string(proof[i].siblingHash + hash);
+            Policy::hash_node(proof[i].siblingHash, hash, hash);
         else
-            hash = picosha2::hash256_hex_string(hash + proof[i].siblingHash);
+            Policy::hash_node(hash, proof[i].siblingHash, hash);
     }
 
-    return hash == rootHash;
+    return hash;
+}
+
+// Verify Merkle Proof
+bool verify_proof(const Digest& leafHash, ProofStep proof[], size_t proofLen, const Digest& rootHash,
+    HashMode mode) {
+    return with_hash_policy(mode, [&](auto policy) {
+        return fold_proof<decltype(policy)>(leafHash, proof, proofLen) == rootHash;
+    });
+}
+
+// Workers own whole 64-proof words of the bitmap, so no two threads ever
+// write the same word
+size_t verify_proofs_batch(const ProofCheck* checks, size_t count, uint64_t* resultBits,
+    HashMode mode, unsigned threads) {
+    size_t words = (count + 63) / 64;
+    vector<size_t> passedPerWord(words, 0);
+
+    with_hash_policy(mode, [&](auto policy) {
+        parallel_for(words, threads, [&](size_t firstWord, size_t lastWord) {
+            for (size_t w = firstWord; w < lastWord; w++) {
+                uint64_t bits = 0;
+                size_t passed = 0;
+                size_t end = min(count, (w + 1) * 64);
+                for (size_t i = w * 64; i < end; i++) {
+                    const ProofCheck& check = checks[i];
+                    if (fold_proof<decltype(policy)>(check.leafHash, check.proof, check.proofLen) == *check.rootHash) {
+                        bits |= (uint64_t)1 << (i - w * 64);
+                        passed++;
+                    }
+                }
+                resultBits[w] = bits;
+                passedPerWord[w] = passed;
+            }
+        });
+    });
+
+    size_t passed = 0;
+    for (size_t p : passedPerWord) passed += p;
+    return passed;
 }
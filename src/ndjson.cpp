@@ -0,0 +1,404 @@
+#include "ndjson.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include "json.hpp"
+#include "parallel.h"
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using json = nlohmann::json;
+
+#if defined(_WIN32)
+
+bool map_file(const string& path, MappedFile& file) {
+    unmap_file(file);
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open()) return false;
+    file.buffer.resize((size_t)in.tellg());
+    in.seekg(0);
+    if (!in.read(&file.buffer[0], file.buffer.size())) return false;
+    file.data = file.buffer.data();
+    file.size = file.buffer.size();
+    return true;
+}
+
+void unmap_file(MappedFile& file) {
+    string().swap(file.buffer);
+    file.data = nullptr;
+    file.size = 0;
+}
+
+#else
+
+bool map_file(const string& path, MappedFile& file) {
+    unmap_file(file);
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return true;
+    }
+
+    void* mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+    madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    file.mapping = mapping;
+    file.data = (const char*)mapping;
+    file.size = (size_t)st.st_size;
+    return true;
+}
+
+void unmap_file(MappedFile& file) {
+    if (file.mapping) munmap(file.mapping, file.size);
+    string().swap(file.buffer);
+    file.mapping = nullptr;
+    file.data = nullptr;
+    file.size = 0;
+}
+
+#endif
+
+vector<size_t> split_at_lines(const MappedFile& file, size_t parts) {
+    vector<size_t> splits(1, 0);
+    for (size_t k = 1; k < parts; k++) {
+        size_t at = max(file.size / parts * k, splits.back());
+        const char* newline = at < file.size ? (const char*)memchr(file.data + at, '\n', file.size - at) : nullptr;
+        if (!newline) break;
+        size_t next = newline - file.data + 1;
+        if (next > splits.back() && next < file.size) splits.push_back(next);
+    }
+    splits.push_back(file.size);
+    return splits;
+}
+
+// ===== Fast field scanner =====
+
+static inline uint64_t has_zero_byte(uint64_t v) {
+    return (v - 0x0101010101010101ULL) & ~v & 0x8080808080808080ULL;
+}
+
+static void skip_ws(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r')) p++;
+}
+
+// Length of the well-formed UTF-8 sequence at p (overlongs, surrogates and
+// code points past U+10FFFF rejected, as json.hpp does), 0 if invalid
+static size_t utf8_sequence(const char* p, const char* end) {
+    const unsigned char* s = (const unsigned char*)p;
+    size_t avail = end - p;
+    unsigned c = s[0];
+    if (c >= 0xc2 && c <= 0xdf)
+        return avail >= 2 && (s[1] & 0xc0) == 0x80 ? 2 : 0;
+    if (c >= 0xe0 && c <= 0xef) {
+        if (avail < 3 || (s[1] & 0xc0) != 0x80 || (s[2] & 0xc0) != 0x80) return 0;
+        if ((c == 0xe0 && s[1] < 0xa0) || (c == 0xed && s[1] > 0x9f)) return 0;
+        return 3;
+    }
+    if (c >= 0xf0 && c <= 0xf4) {
+        if (avail < 4 || (s[1] & 0xc0) != 0x80 || (s[2] & 0xc0) != 0x80 || (s[3] & 0xc0) != 0x80) return 0;
+        if ((c == 0xf0 && s[1] < 0x90) || (c == 0xf4 && s[1] > 0x8f)) return 0;
+        return 4;
+    }
+    return 0;
+}
+
+static bool read_hex4(const char*& p, const char* end, unsigned& value) {
+    if (end - p < 4) return false;
+    value = 0;
+    for (int i = 0; i < 4; i++, p++) {
+        char c = *p;
+        value <<= 4;
+        if (c >= '0' && c <= '9') value |= c - '0';
+        else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+        else return false;
+    }
+    return true;
+}
+
+static void append_utf8(string& out, unsigned cp) {
+    if (cp < 0x80) {
+        out += (char)cp;
+    }
+    else if (cp < 0x800) {
+        out += (char)(0xc0 | (cp >> 6));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+    else if (cp < 0x10000) {
+        out += (char)(0xe0 | (cp >> 12));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+    else {
+        out += (char)(0xf0 | (cp >> 18));
+        out += (char)(0x80 | ((cp >> 12) & 0x3f));
+        out += (char)(0x80 | ((cp >> 6) & 0x3f));
+        out += (char)(0x80 | (cp & 0x3f));
+    }
+}
+
+// String body starting just after the opening quote; p ends up past the
+// closing quote. Plain ASCII is skipped eight bytes at a time and copied to
+// out (when given) in runs.
+static bool scan_string(const char*& p, const char* end, string* out) {
+    const char* run = p;
+    while (true) {
+        while (end - p >= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            uint64_t special = has_zero_byte(w ^ 0x2222222222222222ULL) | has_zero_byte(w ^ 0x5c5c5c5c5c5c5c5cULL)
+                | has_zero_byte(w & 0xe0e0e0e0e0e0e0e0ULL) | (w & 0x8080808080808080ULL);
+            if (special) break;
+            p += 8;
+        }
+        if (p >= end) return false;
+
+        unsigned char c = (unsigned char)*p;
+        if (c == '"') {
+            if (out) out->append(run, p);
+            p++;
+            return true;
+        }
+        if (c < 0x20) return false;
+        if (c >= 0x80) {
+            size_t n = utf8_sequence(p, end);
+            if (n == 0) return false;
+            p += n;
+            continue;
+        }
+        if (c != '\\') {
+            p++;
+            continue;
+        }
+
+        if (out) out->append(run, p);
+        if (++p >= end) return false;
+        char escape = *p++;
+        char plain = 0;
+        switch (escape) {
+        case '"': case '\\': case '/': plain = escape; break;
+        case 'b': plain = '\b'; break;
+        case 'f': plain = '\f'; break;
+        case 'n': plain = '\n'; break;
+        case 'r': plain = '\r'; break;
+        case 't': plain = '\t'; break;
+        case 'u': {
+            unsigned cp;
+            if (!read_hex4(p, end, cp)) return false;
+            if (cp >= 0xdc00 && cp <= 0xdfff) return false;
+            if (cp >= 0xd800 && cp <= 0xdbff) {
+                unsigned low;
+                if (end - p < 2 || p[0] != '\\' || p[1] != 'u') return false;
+                p += 2;
+                if (!read_hex4(p, end, low) || low < 0xdc00 || low > 0xdfff) return false;
+                cp = 0x10000 + ((cp - 0xd800) << 10) + (low - 0xdc00);
+            }
+            if (out) append_utf8(*out, cp);
+            break;
+        }
+        default: return false;
+        }
+        if (plain && out) *out += plain;
+        run = p;
+    }
+}
+
+static bool scan_digits(const char*& p, const char* end) {
+    const char* start = p;
+    while (p < end && *p >= '0' && *p <= '9') p++;
+    return p > start;
+}
+
+// -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool scan_number(const char*& p, const char* end) {
+    if (p < end && *p == '-') p++;
+    if (p < end && *p == '0') p++;
+    else if (!scan_digits(p, end)) return false;
+    if (p < end && *p == '.' && !scan_digits(++p, end)) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if (p < end && (*p == '+' || *p == '-')) p++;
+        if (!scan_digits(p, end)) return false;
+    }
+    return true;
+}
+
+static bool scan_literal(const char*& p, const char* end, const char* word, size_t len) {
+    if ((size_t)(end - p) < len || memcmp(p, word, len) != 0) return false;
+    p += len;
+    return true;
+}
+
+// Any value other than an object or array
+static bool skip_scalar(const char*& p, const char* end) {
+    if (p >= end) return false;
+    switch (*p) {
+    case '"': return scan_string(++p, end, nullptr);
+    case 't': return scan_literal(p, end, "true", 4);
+    case 'f': return scan_literal(p, end, "false", 5);
+    case 'n': return scan_literal(p, end, "null", 4);
+    default: return scan_number(p, end);
+    }
+}
+
+enum ScanResult { SCAN_FOUND, SCAN_MISSING, SCAN_FALLBACK };
+
+static ScanResult scan_record(string_view line, string& id, string& text) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    bool haveId = false, haveText = false;
+
+    skip_ws(p, end);
+    if (p >= end || *p != '{') return SCAN_FALLBACK;
+    p++;
+    skip_ws(p, end);
+    if (p < end && *p == '}') {
+        p++;
+    }
+    else {
+        while (true) {
+            if (p >= end || *p != '"') return SCAN_FALLBACK;
+            const char* key = ++p;
+            if (!scan_string(p, end, nullptr)) return SCAN_FALLBACK;
+            string_view name(key, p - 1 - key);
+            if (name.find('\\') != string_view::npos) return SCAN_FALLBACK;
+
+            skip_ws(p, end);
+            if (p >= end || *p != ':') return SCAN_FALLBACK;
+            p++;
+            skip_ws(p, end);
+
+            // Repeated keys: the last one wins, as in json.hpp
+            string* field = name == "reviewID" ? &id : name == "reviewText" ? &text : nullptr;
+            if (field) {
+                if (p >= end || *p != '"') return SCAN_FALLBACK;
+                p++;
+                field->clear();
+                if (!scan_string(p, end, field)) return SCAN_FALLBACK;
+                (field == &id ? haveId : haveText) = true;
+            }
+            else if (!skip_scalar(p, end)) {
+                return SCAN_FALLBACK;
+            }
+
+            skip_ws(p, end);
+            if (p < end && *p == ',') {
+                p++;
+                skip_ws(p, end);
+                continue;
+            }
+            if (p < end && *p == '}') {
+                p++;
+                break;
+            }
+            return SCAN_FALLBACK;
+        }
+    }
+    skip_ws(p, end);
+    if (p != end) return SCAN_FALLBACK;
+    return haveId && haveText ? SCAN_FOUND : SCAN_MISSING;
+}
+
+bool parse_review_line(string_view line, string& id, string& text, bool* fellBack) {
+    if (fellBack) *fellBack = false;
+    if (line.empty()) return false;
+
+    ScanResult result = scan_record(line, id, text);
+    if (result != SCAN_FALLBACK) return result == SCAN_FOUND;
+
+    if (fellBack) *fellBack = true;
+    try {
+        json j = json::parse(line.begin(), line.end());
+        if (j.contains("reviewID") && j.contains("reviewText")) {
+            id = j["reviewID"].get<string>();
+            text = j["reviewText"].get<string>();
+            return true;
+        }
+    }
+    catch (...) {}
+    return false;
+}
+
+bool scan_review_file(const string& path, const function<void(string&, string&)>& fn, NdjsonStats* stats) {
+    MappedFile file;
+    if (!map_file(path, file)) return false;
+
+    NdjsonStats counts;
+    string id, text;
+    for_each_line(file.data, file.data + file.size, [&](string_view line) {
+        bool fellBack;
+        counts.lines++;
+        if (parse_review_line(line, id, text, &fellBack)) {
+            counts.records++;
+            fn(id, text);
+        }
+        counts.fallbacks += fellBack;
+    });
+
+    unmap_file(file);
+    if (stats) *stats = counts;
+    return true;
+}
+
+bool load_review_file(const string& path, vector<string>& reviewIDs, vector<string>& reviewTexts,
+    unsigned threads, NdjsonStats* stats) {
+    MappedFile file;
+    if (!map_file(path, file)) return false;
+
+    vector<size_t> splits = split_at_lines(file, resolve_thread_count(threads));
+    size_t parts = splits.size() - 1;
+    vector<vector<string>> partIds(parts), partTexts(parts);
+    vector<NdjsonStats> partStats(parts);
+    parallel_for(parts, threads, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; k++) {
+            string id, text;
+            for_each_line(file.data + splits[k], file.data + splits[k + 1], [&](string_view line) {
+                bool fellBack;
+                partStats[k].lines++;
+                if (parse_review_line(line, id, text, &fellBack)) {
+                    partStats[k].records++;
+                    partIds[k].push_back(move(id));
+                    partTexts[k].push_back(move(text));
+                }
+                partStats[k].fallbacks += fellBack;
+            });
+        }
+    });
+    unmap_file(file);
+
+    // Concatenate in file order; each worker moves its parts into place
+    vector<size_t> offsets(parts + 1, 0);
+    NdjsonStats counts;
+    for (size_t k = 0; k < parts; k++) {
+        offsets[k + 1] = offsets[k] + partIds[k].size();
+        counts.lines += partStats[k].lines;
+        counts.records += partStats[k].records;
+        counts.fallbacks += partStats[k].fallbacks;
+    }
+    reviewIDs.clear();
+    reviewTexts.clear();
+    reviewIDs.resize(offsets[parts]);
+    reviewTexts.resize(offsets[parts]);
+    parallel_for(parts, threads, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; k++) {
+            move(partIds[k].begin(), partIds[k].end(), reviewIDs.begin() + offsets[k]);
+            move(partTexts[k].begin(), partTexts[k].end(), reviewTexts.begin() + offsets[k]);
+        }
+    });
+
+    if (stats) *stats = counts;
+    return true;
+}
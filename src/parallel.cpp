@@ -0,0 +1,128 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+unsigned resolve_thread_count(unsigned requested) {
+    if (requested > 0) return requested;
+    unsigned hw = thread::hardware_concurrency();
+    return hw > 0 ? hw : 1;
+}
+
+void parallel_for(size_t count, unsigned threads, const function<void(size_t, size_t)>& body) {
+    if (count == 0) return;
+
+    size_t workers = resolve_thread_count(threads);
+    if (workers > count) workers = count;
+    if (workers <= 1) { body(0, count); return; }
+
+    size_t chunk = count / workers;
+    size_t extra = count % workers;
+
+    vector<thread> pool;
+    pool.reserve(workers - 1);
+
+    size_t begin = chunk + (extra > 0 ? 1 : 0);
+    for (size_t w = 1; w < workers; w++) {
+        size_t end = begin + chunk + (w < extra ? 1 : 0);
+        pool.emplace_back(body, begin, end);
+        begin = end;
+    }
+
+    body(0, chunk + (extra > 0 ? 1 : 0));
+    for (auto& t : pool) t.join();
+}
+
+WorkerPool::~WorkerPool() {
+    stop_worker_pool(*this);
+}
+
+static void worker_loop(WorkerPool& pool) {
+    while (true) {
+        function<void()> task;
+        {
+            unique_lock<mutex> guard(pool.lock);
+            pool.wake.wait(guard, [&] { return pool.stopping || !pool.tasks.empty(); });
+            if (pool.tasks.empty()) return;
+            task = move(pool.tasks.front());
+            pool.tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void start_worker_pool(WorkerPool& pool, unsigned workers) {
+    stop_worker_pool(pool);
+    pool.workers.reserve(workers);
+    for (unsigned w = 0; w < workers; w++) pool.workers.emplace_back(worker_loop, ref(pool));
+}
+
+void stop_worker_pool(WorkerPool& pool) {
+    {
+        lock_guard<mutex> guard(pool.lock);
+        pool.stopping = true;
+    }
+    pool.wake.notify_all();
+    for (auto& t : pool.workers) t.join();
+    pool.workers.clear();
+    pool.stopping = false;
+}
+
+future<void> pool_submit(WorkerPool& pool, function<void()> task) {
+    auto packaged = make_shared<packaged_task<void()>>(move(task));
+    future<void> done = packaged->get_future();
+    if (pool.workers.empty()) {
+        (*packaged)();
+        return done;
+    }
+    {
+        lock_guard<mutex> guard(pool.lock);
+        pool.tasks.push_back([packaged] { (*packaged)(); });
+    }
+    pool.wake.notify_one();
+    return done;
+}
+
+// Shared with the helper tasks, which may start after pool_for() returned;
+// by then every range is claimed and they leave without touching body
+struct PoolForState {
+    atomic<size_t> next{ 0 };
+    size_t ranges = 0, chunk = 0, extra = 0;
+    const function<void(size_t, size_t)>* body = nullptr;
+    mutex lock;
+    condition_variable finished;
+    size_t done = 0;
+};
+
+static void run_ranges(PoolForState& state) {
+    size_t ran = 0;
+    for (size_t r; (r = state.next.fetch_add(1)) < state.ranges; ran++) {
+        size_t begin = r * state.chunk + min(r, state.extra);
+        (*state.body)(begin, begin + state.chunk + (r < state.extra ? 1 : 0));
+    }
+    if (ran == 0) return;
+    lock_guard<mutex> guard(state.lock);
+    state.done += ran;
+    if (state.done == state.ranges) state.finished.notify_one();
+}
+
+void pool_for(WorkerPool& pool, size_t count, const function<void(size_t, size_t)>& body) {
+    if (count == 0) return;
+    size_t ranges = min(count, pool.workers.size() + 1);
+    if (ranges <= 1) { body(0, count); return; }
+
+    auto state = make_shared<PoolForState>();
+    state->ranges = ranges;
+    state->chunk = count / ranges;
+    state->extra = count % ranges;
+    state->body = &body;
+    {
+        lock_guard<mutex> guard(pool.lock);
+        for (size_t h = 1; h < ranges; h++) pool.tasks.push_back([state] { run_ranges(*state); });
+    }
+    pool.wake.notify_all();
+
+    run_ranges(*state);
+    unique_lock<mutex> guard(state->lock);
+    state->finished.wait(guard, [&] { return state->done == state->ranges; });
+}
@@ -0,0 +1,182 @@
+#include "pipeline.h"
+#include <chrono>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include "ndjson.h"
+#include "parallel.h"
+
+// A batch is one aligned block of 2^BATCH_LEVELS leaves (the last one may
+// be short), so its subtree up to that level is part of the final tree
+static const size_t BATCH_LEVELS = 12;
+static const size_t BATCH_RECORDS = (size_t)1 << BATCH_LEVELS;
+static const size_t QUEUE_BATCHES = 4; // per worker, in each direction
+
+struct RecordBatch {
+    vector<string> ids;
+    vector<string> texts;
+    vector<Digest> nodes; // filled by the hash stage: the subtree's levels 0..BATCH_LEVELS
+    bool last = false;    // end of input; nothing else follows on this queue
+};
+
+typedef SpscQueue<RecordBatch> BatchQueue;
+
+// Leaf digests and subtree levels of one batch, pairs hashed in bulk the
+// way build_tree() hashes a level
+template <typename Policy>
+static void hash_batch(RecordBatch& batch) {
+    size_t size = batch.ids.size(), total = 0;
+    for (size_t level = 0, count = size; level <= BATCH_LEVELS; level++, count = (count + 1) / 2) total += count;
+    batch.nodes.resize(total);
+    for (size_t i = 0; i < size; i++) batch.nodes[i] = hash_leaf(batch.ids[i], batch.texts[i], Policy::mode);
+
+    Digest* below = batch.nodes.data();
+    for (size_t level = 1; level <= BATCH_LEVELS; level++) {
+        Digest* above = below + size;
+        if (size >= 2) Policy::hash_pairs(below, size / 2, above);
+        if (size & 1) above[size / 2] = below[size - 1];
+        below = above;
+        size = (size + 1) / 2;
+    }
+}
+
+// Copy batch k's subtree into the reserved tree, then fold its root into
+// the levels above like a leaf joining the right edge of a growing tree.
+// filled[level] counts the nodes written on each level.
+template <typename Policy>
+static void place_batch(MerkleTree& tree, vector<size_t>& filled, const RecordBatch& batch, size_t k) {
+    const Digest* from = batch.nodes.data();
+    size_t size = batch.ids.size();
+    for (size_t level = 0; level <= BATCH_LEVELS && level < tree.levelCount; level++) {
+        memcpy(tree.nodes + tree.levelOffsets[level] + (k << (BATCH_LEVELS - level)), from, size * sizeof(Digest));
+        filled[level] += size;
+        from += size;
+        size = (size + 1) / 2;
+    }
+
+    for (size_t level = BATCH_LEVELS; level + 1 < tree.levelCount && filled[level] % 2 == 0; level++) {
+        const Digest* pair = tree.nodes + tree.levelOffsets[level] + filled[level] - 2;
+        Policy::hash_node(pair[0], pair[1], tree.nodes[tree.levelOffsets[level + 1] + filled[level + 1]++]);
+    }
+}
+
+// Close the right edge above the batch subtrees once the input ends. Going
+// up, an odd level promotes its last node and an even one may still owe
+// the parent of a pair that promotion just completed.
+template <typename Policy>
+static void finish_levels(MerkleTree& tree, vector<size_t>& filled) {
+    for (size_t level = BATCH_LEVELS; level + 1 < tree.levelCount && filled[level] > 1; level++) {
+        const Digest* below = tree.nodes + tree.levelOffsets[level];
+        Digest* above = tree.nodes + tree.levelOffsets[level + 1];
+        size_t count = filled[level];
+        if (count % 2 == 1)
+            above[filled[level + 1]++] = below[count - 1];
+        else if (filled[level + 1] < count / 2)
+            Policy::hash_node(below[count - 2], below[count - 1], above[filled[level + 1]++]);
+    }
+}
+
+template <typename Policy>
+static bool run_pipeline(const MappedFile& file, vector<string>& reviewIDs, vector<string>& reviewTexts,
+    MerkleTree& tree, unsigned threads, PipelineStats& stats) {
+    auto start = chrono::high_resolution_clock::now();
+    size_t workers = max<size_t>(1, resolve_thread_count(threads) - 1);
+    stats.hashWorkers = (unsigned)workers;
+
+    vector<unique_ptr<BatchQueue>> toHash, toBuild;
+    for (size_t w = 0; w < workers; w++) {
+        toHash.emplace_back(new BatchQueue(QUEUE_BATCHES));
+        toBuild.emplace_back(new BatchQueue(QUEUE_BATCHES));
+    }
+
+    // Reader: batches go to worker 0, 1, ..., workers - 1, 0, ...
+    thread reader([&]() {
+        auto readStart = chrono::high_resolution_clock::now();
+        size_t next = 0;
+        RecordBatch batch;
+        string id, text;
+        for_each_line(file.data, file.data + file.size, [&](string_view line) {
+            if (!parse_review_line(line, id, text)) return;
+            batch.ids.push_back(move(id));
+            batch.texts.push_back(move(text));
+            if (batch.ids.size() < BATCH_RECORDS) return;
+            stats.readerStalls += toHash[next]->push(batch);
+            next = (next + 1) % workers;
+            batch = RecordBatch();
+        });
+        if (!batch.ids.empty()) {
+            stats.readerStalls += toHash[next]->push(batch);
+            next = (next + 1) % workers;
+        }
+        for (size_t k = 0; k < workers; k++) {
+            RecordBatch end;
+            end.last = true;
+            stats.readerStalls += toHash[(next + k) % workers]->push(end);
+        }
+        stats.readMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - readStart).count();
+    });
+
+    vector<thread> hashers;
+    for (size_t w = 0; w < workers; w++) {
+        hashers.emplace_back([&, w]() {
+            RecordBatch batch;
+            do {
+                toHash[w]->pop(batch);
+                hash_batch<Policy>(batch);
+                bool last = batch.last;
+                toBuild[w]->push(batch);
+                if (last) break;
+            } while (true);
+        });
+    }
+
+    // Every record is one line, so the line count bounds the leaves. The
+    // count runs here while the reader and hashers get going.
+    size_t capacity = 0;
+    for_each_line(file.data, file.data + file.size, [&](string_view) { capacity++; });
+    reserve_merkle_tree(tree, capacity, Policy::mode);
+    vector<size_t> filled(tree.levelCount);
+    reviewIDs.clear();
+    reviewTexts.clear();
+    reviewIDs.reserve(capacity);
+    reviewTexts.reserve(capacity);
+
+    // Builder: collect in dealing order. The first end marker comes from the
+    // worker the reader would have dealt to next; every other worker has
+    // exactly one end marker left to collect
+    RecordBatch batch;
+    size_t next = 0;
+    for (;; next = (next + 1) % workers) {
+        stats.builderWaits += toBuild[next]->pop(batch);
+        if (batch.last) break;
+        place_batch<Policy>(tree, filled, batch, stats.batches);
+        move(batch.ids.begin(), batch.ids.end(), back_inserter(reviewIDs));
+        move(batch.texts.begin(), batch.texts.end(), back_inserter(reviewTexts));
+        stats.batches++;
+    }
+    for (size_t k = 1; k < workers; k++) toBuild[(next + k) % workers]->pop(batch);
+    reader.join();
+    for (thread& hasher : hashers) hasher.join();
+
+    stats.records = reviewIDs.size();
+    finish_levels<Policy>(tree, filled);
+    finish_reserved_tree(tree, reviewIDs.size(), reviewIDs.data());
+    stats.timeToRootMs = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+    return true;
+}
+
+bool load_and_build(const string& path, vector<string>& reviewIDs, vector<string>& reviewTexts,
+    MerkleTree& tree, HashMode mode, unsigned threads, PipelineStats* stats) {
+    MappedFile file;
+    if (!map_file(path, file)) return false;
+
+    free_merkle_tree(tree);
+    PipelineStats counts;
+    with_hash_policy(mode, [&](auto policy) {
+        run_pipeline<decltype(policy)>(file, reviewIDs, reviewTexts, tree, threads, counts);
+    });
+    unmap_file(file);
+    if (stats) *stats = counts;
+    return true;
+}
@@ -1,8 +1,11 @@
 #include "preprocess.h"
 #include "json.hpp" 
-#include <fstream>
+#include "ndjson.h"
+#include "parallel.h"
 #include <iostream>
 #include <string>
+#include <unordered_set>
+#include <vector>
 using json = nlohmann::json;
 
 // Initialize dynamic array
@@ -28,15 +31,6 @@ std::string trim(const std::string& str) {
     return str.substr(first, (last - first + 1));
 }
 
-// Check if ID exists in array
-bool id_exists(ReviewArray& arr, const std::string& id) {
-    for (size_t i = 0; i < arr.size; i++) {
-        if (arr.reviews[i].reviewID == id)
-            return true;
-    }
-    return false;
-}
-
 // Add review to dynamic array (expand if needed)
 void add_review(ReviewArray& arr, const Review& rev) {
     if (arr.size >= arr.capacity) {
@@ -52,42 +46,86 @@ void add_review(ReviewArray& arr, const Review& rev) {
     arr.reviews[arr.size++] = rev;
 }
 
-// Load JSON reviews into array
-void load_reviews(const std::string& filename, ReviewArray& arr) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+// One dataset line as parsed by a worker; skipped lines are not recorded
+struct ParsedLine {
+    bool hasId;    // reviewID present and not null
+    bool textOk;   // reviewText absent, null or a string
+    std::string reviewID;
+    std::string reviewText; // trimmed
+};
+
+static bool parse_line(std::string_view line, ParsedLine& parsed) {
+    try {
+        auto j = json::parse(line.begin(), line.end());
+        parsed.hasId = j.contains("reviewID") && !j["reviewID"].is_null();
+        if (parsed.hasId)
+            parsed.reviewID = j["reviewID"].get<std::string>();
+
+        parsed.textOk = true;
+        try {
+            if (j.contains("reviewText") && !j["reviewText"].is_null())
+                parsed.reviewText = trim(j["reviewText"].get<std::string>());
+            else
+                parsed.reviewText = "";
+        }
+        catch (...) {
+            parsed.textOk = false;
+        }
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+// Load JSON reviews into array. Line-aligned chunks of the file are parsed
+// in parallel; generated IDs and the uniqueness fixup depend on every
+// earlier record, so that part runs afterwards in file order.
+void load_reviews(const std::string& filename, ReviewArray& arr, unsigned threads) {
+    MappedFile file;
+    if (!map_file(filename, file)) {
         std::cerr << "Cannot open file: " << filename << "\n";
         return;
     }
 
+    std::vector<size_t> splits = split_at_lines(file, resolve_thread_count(threads));
+    size_t parts = splits.size() - 1;
+    std::vector<std::vector<ParsedLine>> parsed(parts);
+    parallel_for(parts, threads, [&](size_t first, size_t last) {
+        for (size_t k = first; k < last; k++) {
+            for_each_line(file.data + splits[k], file.data + splits[k + 1], [&](std::string_view line) {
+                ParsedLine entry;
+                if (parse_line(line, entry)) parsed[k].push_back(std::move(entry));
+            });
+        }
+    });
+    unmap_file(file);
+
+    // Same sequence as a line-by-line load: a text that is not a string
+    // drops the record only after its ID has been made unique
+    std::unordered_set<std::string> ids;
+    for (size_t i = 0; i < arr.size; i++) ids.insert(arr.reviews[i].reviewID);
+
     size_t counter = 1;
-    std::string line;
-    while (std::getline(file, line)) {
-        try {
-            auto j = json::parse(line);
+    for (std::vector<ParsedLine>& part : parsed) {
+        for (ParsedLine& entry : part) {
             Review rev;
-
-            if (j.contains("reviewID") && !j["reviewID"].is_null())
-                rev.reviewID = j["reviewID"].get<std::string>();
+            if (entry.hasId)
+                rev.reviewID = std::move(entry.reviewID);
             else
                 rev.reviewID = "GENID_" + std::to_string(counter);
 
             // Ensure unique ID manually
-            while (id_exists(arr, rev.reviewID)) {
+            while (ids.count(rev.reviewID)) {
                 rev.reviewID = "GENID_" + std::to_string(counter++);
             }
+            if (!entry.textOk) continue;
 
-            if (j.contains("reviewText") && !j["reviewText"].is_null())
-                rev.reviewText = trim(j["reviewText"].get<std::string>());
-            else
-                rev.reviewText = "";
-
+            rev.reviewText = std::move(entry.reviewText);
+            ids.insert(rev.reviewID);
             add_review(arr, rev);
             counter++;
         }
-        catch (...) {
-            continue;
-        }
     }
 
     std::cout << "Loaded " << arr.size << " reviews.\n";
@@ -0,0 +1,84 @@
+#include "proof_format.h"
+#include <cstring>
+
+static void put_u64(uint8_t* p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint64_t get_u64(const uint8_t* p) {
+    uint64_t v = 0;
+    for (int i = 0; i < 8; i++) v |= (uint64_t)p[i] << (8 * i);
+    return v;
+}
+
+size_t serialized_proof_size(size_t proofLen) {
+    return PROOF_HEADER_BYTES + proofLen * sizeof(Digest);
+}
+
+bool proof_path_shape(uint64_t leafIndex, uint64_t leafCount, size_t& steps, uint64_t& directions) {
+    if (leafIndex >= leafCount) return false;
+    steps = 0;
+    directions = 0;
+    for (uint64_t pos = leafIndex, size = leafCount; size > 1; pos >>= 1, size = size / 2 + (size & 1)) {
+        if ((pos ^ 1) >= size) continue; // promoted, no sibling
+        if (pos & 1) directions |= (uint64_t)1 << steps;
+        steps++;
+    }
+    return true;
+}
+
+bool serialize_proof(const ProofStep* proof, size_t proofLen, uint64_t leafIndex, uint64_t leafCount,
+    HashMode mode, vector<uint8_t>& out) {
+    size_t steps;
+    uint64_t directions;
+    if (!proof_path_shape(leafIndex, leafCount, steps, directions) || steps != proofLen) return false;
+    for (size_t i = 0; i < proofLen; i++)
+        if (proof[i].isLeft != (((directions >> i) & 1) != 0)) return false;
+
+    size_t base = out.size();
+    out.resize(base + serialized_proof_size(proofLen));
+    uint8_t* p = out.data() + base;
+    memcpy(p, PROOF_MAGIC, sizeof(PROOF_MAGIC));
+    p[4] = (uint8_t)mode;
+    p[5] = (uint8_t)proofLen;
+    p[6] = p[7] = 0;
+    put_u64(p + 8, leafIndex);
+    put_u64(p + 16, leafCount);
+    for (size_t i = 0; i < proofLen; i++)
+        memcpy(p + PROOF_HEADER_BYTES + i * sizeof(Digest), proof[i].siblingHash.data(), sizeof(Digest));
+    return true;
+}
+
+bool parse_proof(const uint8_t* data, size_t len, ProofView& view) {
+    if (len < PROOF_HEADER_BYTES || memcmp(data, PROOF_MAGIC, sizeof(PROOF_MAGIC)) != 0) return false;
+    size_t steps = data[5];
+    if (steps > PROOF_MAX_STEPS || data[6] != 0 || data[7] != 0 || len != serialized_proof_size(steps))
+        return false;
+
+    view.mode = (HashMode)data[4];
+    view.leafIndex = get_u64(data + 8);
+    view.leafCount = get_u64(data + 16);
+    size_t expectedSteps;
+    if (!proof_path_shape(view.leafIndex, view.leafCount, expectedSteps, view.directions) || expectedSteps != steps)
+        return false;
+    // Digest is a plain byte array, so the payload is usable in place
+    view.siblings.data = reinterpret_cast<const Digest*>(data + PROOF_HEADER_BYTES);
+    view.siblings.size = steps;
+    return true;
+}
+
+bool verify_serialized_proof(const uint8_t* data, size_t len, const Digest& leafHash, const Digest& rootHash,
+    HashMode mode) {
+    ProofView view;
+    if (!parse_proof(data, len, view) || view.mode != mode) return false;
+
+    Digest current = leafHash;
+    with_hash_policy(mode, [&](auto policy) {
+        typedef decltype(policy) Policy;
+        for (size_t i = 0; i < view.siblings.size; i++) {
+            if ((view.directions >> i) & 1) Policy::hash_node(view.siblings[i], current, current);
+            else Policy::hash_node(current, view.siblings[i], current);
+        }
+    });
+    return current == rootHash;
+}
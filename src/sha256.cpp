@@ -0,0 +1,443 @@
+#include "sha256.h"
+#include "picosha2.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <cpuid.h>
+#include <immintrin.h>
+#define SHA256_X86_SIMD 1
+#endif
+
+static const uint32_t K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static const uint32_t H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+static inline uint32_t load_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static inline void store_be32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+// Number of 64-byte blocks after padding a message of len bytes
+static inline size_t padded_blocks(size_t len) {
+    return (len + 9 + 63) / 64;
+}
+
+// Block b of the padded message: message bytes, 0x80, zeros, bit length
+static void padded_block(const uint8_t* msg, size_t len, size_t b, uint8_t block[64]) {
+    size_t off = b * 64;
+    memset(block, 0, 64);
+    if (off < len) memcpy(block, msg + off, min<size_t>(64, len - off));
+    if (len >= off && len - off < 64) block[len - off] = 0x80;
+    if (b + 1 == padded_blocks(len)) {
+        uint64_t bits = (uint64_t)len * 8;
+        for (size_t i = 0; i < 8; i++) block[63 - i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+// ===== Portable backend =====
+static void compress_portable(uint32_t state[8], const uint8_t* blocks, size_t blockCount) {
+    picosha2::word_t h[8];
+    copy(state, state + 8, h);
+    for (size_t b = 0; b < blockCount; b++)
+        picosha2::detail::hash256_block(h, blocks + b * 64, blocks + b * 64 + 64);
+    for (size_t i = 0; i < 8; i++) state[i] = (uint32_t)h[i];
+}
+
+static const Sha256Backend PORTABLE_BACKEND = { "picosha2", compress_portable };
+
+const Sha256Backend& sha256_portable_backend() {
+    return PORTABLE_BACKEND;
+}
+
+// ===== SHA-NI backend =====
+#ifdef SHA256_X86_SIMD
+
+// Four rounds per step on the ABEF/CDGH register layout the SHA instructions
+// use; msg[] is the rolling 16-word schedule, four words per register.
+__attribute__((target("sha,sse4.1,ssse3")))
+static void compress_shani(uint32_t state[8], const uint8_t* blocks, size_t blockCount) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xB1); // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1B); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);    // ABEF
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);          // CDGH
+
+    for (size_t b = 0; b < blockCount; b++) {
+        const uint8_t* block = blocks + b * 64;
+        __m128i abefSave = state0;
+        __m128i cdghSave = state1;
+
+        __m128i msg[4];
+        for (int i = 0; i < 4; i++)
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + 16 * i)), byteSwap);
+
+#pragma GCC unroll 16
+        for (int i = 0; i < 16; i++) {
+            __m128i& cur = msg[i & 3];
+            __m128i& next = msg[(i + 1) & 3];
+            __m128i& prev = msg[(i + 3) & 3];
+
+            __m128i m = _mm_add_epi32(cur, _mm_loadu_si128((const __m128i*)&K[4 * i]));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+            if (i >= 3 && i <= 14) {
+                next = _mm_add_epi32(next, _mm_alignr_epi8(cur, prev, 4));
+                next = _mm_sha256msg2_epu32(next, cur);
+            }
+            m = _mm_shuffle_epi32(m, 0x0E);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+            if (i >= 1 && i <= 12)
+                prev = _mm_sha256msg1_epu32(prev, cur);
+        }
+
+        state0 = _mm_add_epi32(state0, abefSave);
+        state1 = _mm_add_epi32(state1, cdghSave);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);                // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xB1);             // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);          // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);             // ABEF
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+static bool cpu_has_shani() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    bool ssse3 = (ecx & (1u << 9)) != 0;
+    bool sse41 = (ecx & (1u << 19)) != 0;
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+    bool sha = (ebx & (1u << 29)) != 0;
+    return ssse3 && sse41 && sha;
+}
+
+static const Sha256Backend SHANI_BACKEND = { "sha-ni", compress_shani };
+
+const Sha256Backend* sha256_shani_backend() {
+    static const bool supported = cpu_has_shani();
+    return supported ? &SHANI_BACKEND : nullptr;
+}
+
+#else
+
+const Sha256Backend* sha256_shani_backend() {
+    return nullptr;
+}
+
+#endif
+
+const Sha256Backend& sha256_backend() {
+    static const Sha256Backend& selected =
+        sha256_shani_backend() ? *sha256_shani_backend() : sha256_portable_backend();
+    return selected;
+}
+
+// SHA-256 of a contiguous buffer without touching the heap; picosha2's own
+// hasher copies every input into a growing std::vector first
+void sha256_digest_with(const Sha256Backend& backend, const uint8_t* data, size_t len, Digest& out) {
+    uint32_t h[8];
+    copy(H0, H0 + 8, h);
+
+    size_t full = len / 64;
+    backend.compress(h, data, full);
+
+    uint8_t tail[128];
+    size_t tailBlocks = padded_blocks(len) - full;
+    for (size_t b = 0; b < tailBlocks; b++)
+        padded_block(data, len, full + b, tail + 64 * b);
+    backend.compress(h, tail, tailBlocks);
+
+    for (size_t i = 0; i < 8; i++)
+        store_be32(out.data() + 4 * i, h[i]);
+}
+
+void sha256_digest(const uint8_t* data, size_t len, Digest& out) {
+    sha256_digest_with(sha256_backend(), data, len, out);
+}
+
+void sha256_init(Sha256State& state) {
+    state.backend = &sha256_backend();
+    copy(H0, H0 + 8, state.h);
+    state.blockLen = 0;
+    state.total = 0;
+}
+
+void sha256_update(Sha256State& state, const uint8_t* data, size_t len) {
+    state.total += len;
+    if (state.blockLen > 0) {
+        size_t take = min<size_t>(64 - state.blockLen, len);
+        memcpy(state.block + state.blockLen, data, take);
+        state.blockLen += take;
+        data += take;
+        len -= take;
+        if (state.blockLen < 64) return;
+        state.backend->compress(state.h, state.block, 1);
+        state.blockLen = 0;
+    }
+
+    size_t full = len / 64;
+    state.backend->compress(state.h, data, full);
+    state.blockLen = len - full * 64;
+    memcpy(state.block, data + full * 64, state.blockLen);
+}
+
+void sha256_final(Sha256State& state, Digest& out) {
+    // Buffered bytes, 0x80, zeros, then the bit length of the whole message
+    uint8_t tail[128] = {};
+    memcpy(tail, state.block, state.blockLen);
+    tail[state.blockLen] = 0x80;
+    size_t tailLen = state.blockLen + 9 <= 64 ? 64 : 128;
+    uint64_t bits = state.total * 8;
+    for (size_t i = 0; i < 8; i++) tail[tailLen - 1 - i] = (uint8_t)(bits >> (8 * i));
+    state.backend->compress(state.h, tail, tailLen / 64);
+
+    for (size_t i = 0; i < 8; i++)
+        store_be32(out.data() + 4 * i, state.h[i]);
+}
+
+// Message schedule of a block that holds no message bytes (only padding and
+// length), which is the same in every lane; for fixed-size internal-node
+// messages this is the whole final block, so it is computed once per batch.
+static void padding_schedule(size_t len, size_t b, uint32_t w[64]) {
+    uint8_t block[64];
+    padded_block(nullptr, len, b, block);
+    for (size_t t = 0; t < 16; t++) w[t] = load_be32(block + 4 * t);
+    for (size_t t = 16; t < 64; t++) {
+        uint32_t s0 = ((w[t - 15] >> 7) | (w[t - 15] << 25)) ^ ((w[t - 15] >> 18) | (w[t - 15] << 14)) ^ (w[t - 15] >> 3);
+        uint32_t s1 = ((w[t - 2] >> 17) | (w[t - 2] << 15)) ^ ((w[t - 2] >> 19) | (w[t - 2] << 13)) ^ (w[t - 2] >> 10);
+        w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+    }
+    for (size_t t = 0; t < 64; t++) w[t] += K[t];
+}
+
+// Transposed message words for one block: words[t * lanes + lane]
+static void gather_block(const uint8_t* const* messages, size_t len, size_t b, size_t lanes, uint32_t* words) {
+    size_t off = b * 64;
+    uint8_t block[64];
+    for (size_t lane = 0; lane < lanes; lane++) {
+        const uint8_t* src = messages[lane] + off;
+        if (off + 64 > len) {
+            padded_block(messages[lane], len, b, block);
+            src = block;
+        }
+        for (size_t t = 0; t < 16; t++)
+            words[t * lanes + lane] = load_be32(src + 4 * t);
+    }
+}
+
+#ifdef SHA256_X86_SIMD
+
+#define AVX2_ROTR(x, n) _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - (n)))
+
+__attribute__((target("avx2")))
+static void sha256_x8_avx2(const uint8_t* const* messages, size_t len, Digest* digests) {
+    __m256i state[8];
+    for (size_t i = 0; i < 8; i++) state[i] = _mm256_set1_epi32((int)H0[i]);
+
+    size_t blocks = padded_blocks(len);
+    alignas(32) uint32_t words[16 * 8];
+    uint32_t padW[64];
+    size_t padBlock = blocks; // first block with no message bytes, schedule shared by all lanes
+
+    for (size_t b = 0; b < blocks; b++) {
+        __m256i w[64];
+        bool shared = b * 64 >= len;
+        if (shared) {
+            if (padBlock != b) { padding_schedule(len, b, padW); padBlock = b; }
+        }
+        else {
+            gather_block(messages, len, b, 8, words);
+            for (size_t t = 0; t < 16; t++) w[t] = _mm256_load_si256((const __m256i*)(words + t * 8));
+            for (size_t t = 16; t < 64; t++) {
+                __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(w[t - 15], 7), AVX2_ROTR(w[t - 15], 18)),
+                    _mm256_srli_epi32(w[t - 15], 3));
+                __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(w[t - 2], 17), AVX2_ROTR(w[t - 2], 19)),
+                    _mm256_srli_epi32(w[t - 2], 10));
+                w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+            }
+            for (size_t t = 0; t < 64; t++) w[t] = _mm256_add_epi32(w[t], _mm256_set1_epi32((int)K[t]));
+        }
+
+        __m256i a = state[0], bb = state[1], c = state[2], d = state[3];
+        __m256i e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t t = 0; t < 64; t++) {
+            __m256i kw = shared ? _mm256_set1_epi32((int)padW[t]) : w[t];
+            __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(e, 6), AVX2_ROTR(e, 11)), AVX2_ROTR(e, 25));
+            __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+            __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(h, S1), _mm256_add_epi32(ch, kw));
+            __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(AVX2_ROTR(a, 2), AVX2_ROTR(a, 13)), AVX2_ROTR(a, 22));
+            __m256i maj = _mm256_or_si256(_mm256_and_si256(_mm256_or_si256(a, bb), c), _mm256_and_si256(a, bb));
+            __m256i t2 = _mm256_add_epi32(S0, maj);
+            h = g; g = f; f = e;
+            e = _mm256_add_epi32(d, t1);
+            d = c; c = bb; bb = a;
+            a = _mm256_add_epi32(t1, t2);
+        }
+        state[0] = _mm256_add_epi32(state[0], a);
+        state[1] = _mm256_add_epi32(state[1], bb);
+        state[2] = _mm256_add_epi32(state[2], c);
+        state[3] = _mm256_add_epi32(state[3], d);
+        state[4] = _mm256_add_epi32(state[4], e);
+        state[5] = _mm256_add_epi32(state[5], f);
+        state[6] = _mm256_add_epi32(state[6], g);
+        state[7] = _mm256_add_epi32(state[7], h);
+    }
+
+    alignas(32) uint32_t out[8 * 8];
+    for (size_t i = 0; i < 8; i++) _mm256_store_si256((__m256i*)(out + i * 8), state[i]);
+    for (size_t lane = 0; lane < 8; lane++)
+        for (size_t i = 0; i < 8; i++)
+            store_be32(digests[lane].data() + 4 * i, out[i * 8 + lane]);
+}
+
+// GCC 12 flags the undefined-vector helpers inside its own AVX-512
+// intrinsics (set1, ror, ternarylogic) as maybe-uninitialized; the
+// suppression covers this kernel only (Clang has no such warning)
+#ifndef __clang__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+__attribute__((target("avx512f")))
+static void sha256_x16_avx512(const uint8_t* const* messages, size_t len, Digest* digests) {
+    __m512i state[8];
+    for (size_t i = 0; i < 8; i++) state[i] = _mm512_set1_epi32((int)H0[i]);
+
+    size_t blocks = padded_blocks(len);
+    alignas(64) uint32_t words[16 * 16];
+    uint32_t padW[64];
+    size_t padBlock = blocks;
+
+    for (size_t b = 0; b < blocks; b++) {
+        __m512i w[64];
+        bool shared = b * 64 >= len;
+        if (shared) {
+            if (padBlock != b) { padding_schedule(len, b, padW); padBlock = b; }
+        }
+        else {
+            gather_block(messages, len, b, 16, words);
+            for (size_t t = 0; t < 16; t++) w[t] = _mm512_load_si512((const void*)(words + t * 16));
+            for (size_t t = 16; t < 64; t++) {
+                __m512i s0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w[t - 15], 7), _mm512_ror_epi32(w[t - 15], 18),
+                    _mm512_srli_epi32(w[t - 15], 3), 0x96);
+                __m512i s1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(w[t - 2], 17), _mm512_ror_epi32(w[t - 2], 19),
+                    _mm512_srli_epi32(w[t - 2], 10), 0x96);
+                w[t] = _mm512_add_epi32(_mm512_add_epi32(w[t - 16], s0), _mm512_add_epi32(w[t - 7], s1));
+            }
+            for (size_t t = 0; t < 64; t++) w[t] = _mm512_add_epi32(w[t], _mm512_set1_epi32((int)K[t]));
+        }
+
+        __m512i a = state[0], bb = state[1], c = state[2], d = state[3];
+        __m512i e = state[4], f = state[5], g = state[6], h = state[7];
+        for (size_t t = 0; t < 64; t++) {
+            __m512i kw = shared ? _mm512_set1_epi32((int)padW[t]) : w[t];
+            // 0x96 = a ^ b ^ c, 0xca = a ? b : c (ch), 0xe8 = majority
+            __m512i S1 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(e, 6), _mm512_ror_epi32(e, 11),
+                _mm512_ror_epi32(e, 25), 0x96);
+            __m512i ch = _mm512_ternarylogic_epi32(e, f, g, 0xca);
+            __m512i t1 = _mm512_add_epi32(_mm512_add_epi32(h, S1), _mm512_add_epi32(ch, kw));
+            __m512i S0 = _mm512_ternarylogic_epi32(_mm512_ror_epi32(a, 2), _mm512_ror_epi32(a, 13),
+                _mm512_ror_epi32(a, 22), 0x96);
+            __m512i maj = _mm512_ternarylogic_epi32(a, bb, c, 0xe8);
+            __m512i t2 = _mm512_add_epi32(S0, maj);
+            h = g; g = f; f = e;
+            e = _mm512_add_epi32(d, t1);
+            d = c; c = bb; bb = a;
+            a = _mm512_add_epi32(t1, t2);
+        }
+        state[0] = _mm512_add_epi32(state[0], a);
+        state[1] = _mm512_add_epi32(state[1], bb);
+        state[2] = _mm512_add_epi32(state[2], c);
+        state[3] = _mm512_add_epi32(state[3], d);
+        state[4] = _mm512_add_epi32(state[4], e);
+        state[5] = _mm512_add_epi32(state[5], f);
+        state[6] = _mm512_add_epi32(state[6], g);
+        state[7] = _mm512_add_epi32(state[7], h);
+    }
+
+    alignas(64) uint32_t out[8 * 16];
+    for (size_t i = 0; i < 8; i++) _mm512_store_si512((void*)(out + i * 16), state[i]);
+    for (size_t lane = 0; lane < 16; lane++)
+        for (size_t i = 0; i < 8; i++)
+            store_be32(digests[lane].data() + 4 * i, out[i * 16 + lane]);
+}
+#ifndef __clang__
+#pragma GCC diagnostic pop
+#endif
+
+static unsigned detect_lanes() {
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) return 16;
+    if (__builtin_cpu_supports("avx2")) return 8;
+    return 1;
+}
+
+#else
+
+static unsigned detect_lanes() {
+    return 1;
+}
+
+#endif
+
+unsigned sha256_multi_lanes() {
+    static const unsigned lanes = detect_lanes();
+    return lanes;
+}
+
+// Run one SIMD group; a short tail is padded with copies of its first
+// message and the extra lanes are discarded
+static void sha256_group(const uint8_t* const* messages, size_t len, size_t count, Digest* digests, unsigned lanes) {
+#ifdef SHA256_X86_SIMD
+    const uint8_t* lanePtrs[16];
+    Digest laneOut[16];
+    for (size_t i = 0; i < lanes; i++) lanePtrs[i] = messages[i < count ? i : 0];
+
+    if (lanes == 16) sha256_x16_avx512(lanePtrs, len, laneOut);
+    else sha256_x8_avx2(lanePtrs, len, laneOut);
+
+    copy(laneOut, laneOut + count, digests);
+#else
+    (void)lanes;
+    for (size_t i = 0; i < count; i++) sha256_digest(messages[i], len, digests[i]);
+#endif
+}
+
+void sha256_multi(const uint8_t* const* messages, size_t len, size_t count, Digest* digests, unsigned maxLanes) {
+    unsigned lanes = sha256_multi_lanes();
+    if (maxLanes > 0 && maxLanes < lanes) lanes = maxLanes >= 8 ? 8 : 1;
+    // One SHA-NI stream outruns eight AVX2 lanes, but not sixteen AVX-512 ones
+    if (maxLanes == 0 && lanes == 8 && sha256_shani_backend()) lanes = 1;
+
+    size_t i = 0;
+    if (lanes > 1) {
+        for (; i + lanes <= count; i += lanes)
+            sha256_group(messages + i, len, lanes, digests + i, lanes);
+        // A SIMD pass costs about as much as two or three scalar hashes
+        if (count - i >= 3) {
+            unsigned tailLanes = (lanes == 16 && count - i <= 8) ? 8 : lanes;
+            sha256_group(messages + i, len, count - i, digests + i, tailLanes);
+            i = count;
+        }
+    }
+    for (; i < count; i++)
+        sha256_digest(messages[i], len, digests[i]);
+}
@@ -0,0 +1,285 @@
+#include "sparse_merkle.h"
+#include "parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <mutex>
+
+static int key_bit(const Digest& key, size_t bit) {
+    return (key[bit >> 3] >> (7 - (bit & 7))) & 1;
+}
+
+// First bit at which two keys differ, 256 if they are equal
+static size_t first_diff_bit(const Digest& a, const Digest& b) {
+    for (size_t i = 0; i < a.size(); i++) {
+        uint8_t x = a[i] ^ b[i];
+        if (x == 0) continue;
+        size_t bit = i * 8;
+        while ((x & 0x80) == 0) {
+            x <<= 1;
+            bit++;
+        }
+        return bit;
+    }
+    return 256;
+}
+
+// Leaves and branches are hashed under different one-byte prefixes, so a
+// leaf's key and value can never pass for a branch's two children
+static const uint8_t SPARSE_LEAF_PREFIX = 0x00;
+static const uint8_t SPARSE_BRANCH_PREFIX = 0x01;
+
+static void sparse_hash(uint8_t prefix, const Digest& a, const Digest& b, Digest& out, HashMode mode) {
+    uint8_t message[1 + 2 * sizeof(Digest)];
+    message[0] = prefix;
+    memcpy(message + 1, a.data(), sizeof(Digest));
+    memcpy(message + 1 + sizeof(Digest), b.data(), sizeof(Digest));
+    with_hash_policy(mode, [&](auto policy) { decltype(policy)::hash(message, sizeof(message), out); });
+}
+
+static void hash_sparse_leaf(const Digest& key, const Digest& value, Digest& out, HashMode mode) {
+    sparse_hash(SPARSE_LEAF_PREFIX, key, value, out, mode);
+}
+
+static void hash_sparse_branch(const Digest& left, const Digest& right, Digest& out, HashMode mode) {
+    sparse_hash(SPARSE_BRANCH_PREFIX, left, right, out, mode);
+}
+
+Digest sparse_key(const string& reviewID) {
+    Digest key;
+    sha256_digest((const uint8_t*)reviewID.data(), reviewID.size(), key);
+    return key;
+}
+
+const Digest* sparse_empty_digests(HashMode mode) {
+    static Digest tables[HASH_MODE_XXH3_128 + 1][257];
+    static once_flag computed[HASH_MODE_XXH3_128 + 1];
+
+    size_t m = (mode >= HASH_MODE_HEX_CONCAT && mode <= HASH_MODE_XXH3_128) ? mode : HASH_MODE_BINARY;
+    call_once(computed[m], [m]() {
+        tables[m][256] = Digest{};
+        for (size_t d = 256; d-- > 0;)
+            hash_sparse_branch(tables[m][d + 1], tables[m][d + 1], tables[m][d], (HashMode)m);
+    });
+    return tables[m];
+}
+
+// Digest of a node's subtree as seen from the shallower depth `depth`:
+// leaves collapse, branches are folded up with EMPTY siblings
+static Digest lift(const SparseMerkleTree& tree, uint32_t n, size_t depth) {
+    const SparseNode& node = tree.nodes[n];
+    Digest h = node.hash;
+    if (node.isLeaf) return h;
+
+    const Digest& key = tree.leaves[node.leaf].key;
+    const Digest* empty = sparse_empty_digests(tree.mode);
+    for (size_t d = node.depth; d > depth; d--) {
+        if (key_bit(key, d - 1)) hash_sparse_branch(empty[d], h, h, tree.mode);
+        else hash_sparse_branch(h, empty[d], h, tree.mode);
+    }
+    return h;
+}
+
+static void rehash_branch(SparseMerkleTree& tree, uint32_t n) {
+    size_t below = tree.nodes[n].depth + 1u;
+    Digest left = lift(tree, tree.nodes[n].child[0], below);
+    Digest right = lift(tree, tree.nodes[n].child[1], below);
+    hash_sparse_branch(left, right, tree.nodes[n].hash, tree.mode);
+}
+
+static uint32_t add_leaf(SparseMerkleTree& tree, const Digest& key, const Digest& value) {
+    SparseNode node;
+    node.child[0] = node.child[1] = SPARSE_NONE;
+    node.leaf = (uint32_t)tree.leaves.size();
+    node.depth = 256;
+    node.isLeaf = true;
+    hash_sparse_leaf(key, value, node.hash, tree.mode);
+    tree.leaves.push_back({ key, value });
+    tree.nodes.push_back(node);
+    return (uint32_t)tree.nodes.size() - 1;
+}
+
+static uint32_t add_branch(SparseMerkleTree& tree, size_t depth, uint32_t left, uint32_t right) {
+    SparseNode node;
+    node.child[0] = left;
+    node.child[1] = right;
+    node.leaf = tree.nodes[left].leaf;
+    node.depth = (uint16_t)depth;
+    node.isLeaf = false;
+    tree.nodes.push_back(node);
+    uint32_t n = (uint32_t)tree.nodes.size() - 1;
+    rehash_branch(tree, n);
+    return n;
+}
+
+void init_sparse_tree(SparseMerkleTree& tree, HashMode mode) {
+    tree.nodes.clear();
+    tree.leaves.clear();
+    tree.root = SPARSE_NONE;
+    tree.mode = mode;
+}
+
+// Subtree over sorted, distinct keys [first, last)
+static uint32_t build_range(SparseMerkleTree& tree, const vector<SparseLeaf>& sorted, size_t first, size_t last) {
+    if (last - first == 1) return add_leaf(tree, sorted[first].key, sorted[first].value);
+
+    // Sorted, so the range's common prefix is that of its two ends
+    size_t split = first_diff_bit(sorted[first].key, sorted[last - 1].key);
+    size_t mid = partition_point(sorted.begin() + first, sorted.begin() + last,
+        [split](const SparseLeaf& leaf) { return key_bit(leaf.key, split) == 0; }) - sorted.begin();
+
+    uint32_t left = build_range(tree, sorted, first, mid);
+    uint32_t right = build_range(tree, sorted, mid, last);
+    return add_branch(tree, split, left, right);
+}
+
+void build_sparse_tree(SparseMerkleTree& tree, const string* reviewIDs, const string* reviewTexts, size_t n,
+    HashMode mode, unsigned threads) {
+    init_sparse_tree(tree, mode);
+    if (n == 0) return;
+
+    vector<SparseLeaf> sorted(n);
+    parallel_for(n, threads, [&](size_t first, size_t last) {
+        for (size_t i = first; i < last; i++) {
+            sorted[i].key = sparse_key(reviewIDs[i]);
+            sorted[i].value = hash_leaf(reviewIDs[i], reviewTexts[i], mode);
+        }
+    });
+
+    // Stable, so the last occurrence of a repeated key ends its run
+    stable_sort(sorted.begin(), sorted.end(),
+        [](const SparseLeaf& a, const SparseLeaf& b) { return a.key < b.key; });
+    size_t unique = 0;
+    for (size_t i = 0; i < sorted.size(); i++) {
+        if (i + 1 < sorted.size() && sorted[i + 1].key == sorted[i].key) continue;
+        sorted[unique++] = sorted[i];
+    }
+    sorted.resize(unique);
+
+    tree.nodes.reserve(2 * unique);
+    tree.leaves.reserve(unique);
+    tree.root = build_range(tree, sorted, 0, unique);
+}
+
+void sparse_insert(SparseMerkleTree& tree, const string& reviewID, const string& reviewText) {
+    Digest key = sparse_key(reviewID);
+    Digest value = hash_leaf(reviewID, reviewText, tree.mode);
+    if (tree.root == SPARSE_NONE) {
+        tree.root = add_leaf(tree, key, value);
+        return;
+    }
+
+    // Descend while the key stays inside each branch's prefix
+    vector<uint32_t> path;
+    uint32_t n = tree.root;
+    int side = 0;
+    size_t diff;
+    while (true) {
+        const SparseNode& node = tree.nodes[n];
+        diff = first_diff_bit(key, tree.leaves[node.leaf].key);
+        if (node.isLeaf || diff < node.depth) break;
+        path.push_back(n);
+        side = key_bit(key, node.depth);
+        n = node.child[side];
+    }
+
+    uint32_t replacement;
+    if (tree.nodes[n].isLeaf && diff == 256) {
+        tree.leaves[tree.nodes[n].leaf].value = value;
+        hash_sparse_leaf(key, value, tree.nodes[n].hash, tree.mode);
+        replacement = n;
+    }
+    else {
+        // New branch where the key leaves the existing subtree
+        uint32_t leaf = add_leaf(tree, key, value);
+        replacement = key_bit(key, diff) ? add_branch(tree, diff, n, leaf) : add_branch(tree, diff, leaf, n);
+    }
+
+    if (path.empty()) tree.root = replacement;
+    else tree.nodes[path.back()].child[side] = replacement;
+    for (size_t k = path.size(); k-- > 0;)
+        rehash_branch(tree, path[k]);
+}
+
+Digest sparse_root(const SparseMerkleTree& tree) {
+    if (tree.root == SPARSE_NONE) return sparse_empty_digests(tree.mode)[0];
+    return lift(tree, tree.root, 0);
+}
+
+static void add_sibling(SparseProof& proof, size_t depth, const Digest& sibling) {
+    proof.nonEmpty[(depth - 1) >> 3] |= (uint8_t)(1 << ((depth - 1) & 7));
+    proof.siblings.push_back(sibling);
+}
+
+bool generate_sparse_proof(const SparseMerkleTree& tree, const string& reviewID, SparseProof& proof) {
+    proof = SparseProof();
+    if (tree.root == SPARSE_NONE) return false;
+
+    Digest key = sparse_key(reviewID);
+    uint32_t n = tree.root;
+    size_t depth = 0;
+    while (true) {
+        const SparseNode& node = tree.nodes[n];
+        const SparseLeaf& leaf = tree.leaves[node.leaf];
+        if (node.isLeaf) {
+            proof.depth = (uint16_t)depth;
+            proof.terminalLeaf = true;
+            proof.leafKey = leaf.key;
+            proof.leafValue = leaf.value;
+            return leaf.key == key;
+        }
+
+        // The key turns off the branch's prefix into an empty subtree
+        size_t diff = first_diff_bit(key, leaf.key);
+        if (diff < node.depth) {
+            add_sibling(proof, diff + 1, lift(tree, n, diff + 1));
+            proof.depth = (uint16_t)(diff + 1);
+            return false;
+        }
+
+        int side = key_bit(key, node.depth);
+        add_sibling(proof, node.depth + 1u, lift(tree, node.child[1 - side], node.depth + 1u));
+        n = node.child[side];
+        depth = node.depth + 1u;
+    }
+}
+
+// Fold the proof's terminal up the key's path
+static bool fold_sparse_proof(const Digest& key, const SparseProof& proof, HashMode mode, Digest& root) {
+    if (proof.depth > 256) return false;
+    const Digest* empty = sparse_empty_digests(mode);
+
+    Digest h = empty[proof.depth];
+    if (proof.terminalLeaf) hash_sparse_leaf(proof.leafKey, proof.leafValue, h, mode);
+
+    size_t next = proof.siblings.size();
+    for (size_t t = proof.depth; t > 0; t--) {
+        const Digest* sibling = &empty[t];
+        if ((proof.nonEmpty[(t - 1) >> 3] >> ((t - 1) & 7)) & 1) {
+            if (next == 0) return false;
+            sibling = &proof.siblings[--next];
+        }
+        if (key_bit(key, t - 1)) hash_sparse_branch(*sibling, h, h, mode);
+        else hash_sparse_branch(h, *sibling, h, mode);
+    }
+    root = h;
+    return next == 0;
+}
+
+bool verify_sparse_membership(const Digest& root, const string& reviewID, const Digest& value,
+    const SparseProof& proof, HashMode mode) {
+    Digest key = sparse_key(reviewID);
+    if (!proof.terminalLeaf || proof.leafKey != key || proof.leafValue != value) return false;
+
+    Digest computed;
+    return fold_sparse_proof(key, proof, mode, computed) && computed == root;
+}
+
+bool verify_sparse_absence(const Digest& root, const string& reviewID, const SparseProof& proof, HashMode mode) {
+    Digest key = sparse_key(reviewID);
+    // A different leaf may only end the path if it really sits on it
+    if (proof.terminalLeaf && (proof.leafKey == key || first_diff_bit(proof.leafKey, key) < proof.depth))
+        return false;
+
+    Digest computed;
+    return fold_sparse_proof(key, proof, mode, computed) && computed == root;
+}
@@ -0,0 +1,139 @@
+#include "tree_image.h"
+#include <cstring>
+#include <fstream>
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool save_tree_image(const MerkleTree& tree, const string& path) {
+    if (tree.nodeCount == 0 || tree.levelCount > 64) return false;
+
+    TreeImageHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TREE_IMAGE_MAGIC, sizeof(header.magic));
+    header.version = TREE_IMAGE_VERSION;
+    header.hashMode = tree.mode;
+    header.layout = TREE_LAYOUT_LEVEL_ORDER;
+    header.leafCount = tree.leafCount;
+    header.levelCount = tree.levelCount;
+    header.nodeCount = tree.nodeCount;
+    header.nodesOffset = (sizeof(header) + TREE_IMAGE_ALIGN - 1) / TREE_IMAGE_ALIGN * TREE_IMAGE_ALIGN;
+    for (size_t level = 0; level < tree.levelCount; level++)
+        header.levelOffsets[level] = tree.levelOffsets[level];
+    header.root = get_merkle_root(tree);
+
+    ofstream out(path, ios::binary | ios::trunc);
+    if (!out.is_open()) return false;
+
+    char padding[TREE_IMAGE_ALIGN] = {};
+    out.write((const char*)&header, sizeof(header));
+    out.write(padding, header.nodesOffset - sizeof(header));
+    out.write((const char*)tree.nodes, tree.nodeCount * sizeof(Digest));
+    return (bool)out;
+}
+
+// Everything the header claims must match the layout the leaf count implies
+static bool valid_header(const TreeImageHeader& header, uint64_t fileBytes) {
+    if (memcmp(header.magic, TREE_IMAGE_MAGIC, sizeof(header.magic)) != 0) return false;
+    if (header.version != TREE_IMAGE_VERSION || header.layout != TREE_LAYOUT_LEVEL_ORDER) return false;
+
+    HashMode mode;
+    if (!hash_mode_from_version(header.hashMode, mode)) return false;
+    if (header.leafCount == 0 || header.levelCount == 0 || header.levelCount > 64) return false;
+
+    uint64_t nodes = 0, count = header.leafCount;
+    for (uint64_t level = 0; level < header.levelCount; level++) {
+        if (header.levelOffsets[level] != nodes) return false;
+        bool top = level + 1 == header.levelCount;
+        if (top != (count == 1)) return false;
+        nodes += count;
+        count = (count + 1) / 2;
+    }
+    if (nodes != header.nodeCount) return false;
+
+    if (header.nodesOffset < sizeof(header) || header.nodesOffset % TREE_IMAGE_ALIGN != 0) return false;
+    return fileBytes >= header.nodesOffset && (fileBytes - header.nodesOffset) / sizeof(Digest) >= header.nodeCount;
+}
+
+// Point the tree at a validated node array; the level table goes in the arena
+static void attach_nodes(MerkleTree& tree, const TreeImageHeader& header, Digest* nodes) {
+    tree.mode = (HashMode)header.hashMode;
+    tree.leafCount = header.leafCount;
+    tree.levelCount = header.levelCount;
+    tree.nodeCount = header.nodeCount;
+    tree.levelOffsets = arena_new_array<size_t>(tree.arena, tree.levelCount);
+    for (size_t level = 0; level < tree.levelCount; level++)
+        tree.levelOffsets[level] = header.levelOffsets[level];
+    tree.nodes = nodes;
+}
+
+#if defined(_WIN32)
+
+// No mmap here: read the node array into the arena instead
+bool open_tree_image(const string& path, MerkleTree& tree) {
+    ifstream in(path, ios::binary | ios::ate);
+    if (!in.is_open()) return false;
+    uint64_t fileBytes = (uint64_t)in.tellg();
+    in.seekg(0);
+
+    TreeImageHeader header;
+    if (fileBytes < sizeof(header) || !in.read((char*)&header, sizeof(header))) return false;
+    if (!valid_header(header, fileBytes)) return false;
+
+    Digest* nodes = (Digest*)arena_alloc(tree.arena, header.nodeCount * sizeof(Digest), 64);
+    in.seekg(header.nodesOffset);
+    if (!in.read((char*)nodes, header.nodeCount * sizeof(Digest)) || nodes[header.nodeCount - 1] != header.root) {
+        arena_release(tree.arena);
+        return false;
+    }
+    attach_nodes(tree, header, nodes);
+    return true;
+}
+
+void close_tree_image(MerkleTree& tree) {
+    tree.image = nullptr;
+    tree.imageBytes = 0;
+}
+
+#else
+
+bool open_tree_image(const string& path, MerkleTree& tree) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t)st.st_size < sizeof(TreeImageHeader)) {
+        close(fd);
+        return false;
+    }
+
+    // Private writable mapping: edits made through update_leaf() land on
+    // copied pages and never reach the file
+    size_t bytes = (size_t)st.st_size;
+    void* image = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (image == MAP_FAILED) return false;
+
+    const TreeImageHeader& header = *(const TreeImageHeader*)image;
+    Digest* nodes = (Digest*)((uint8_t*)image + header.nodesOffset);
+    if (!valid_header(header, bytes) || nodes[header.nodeCount - 1] != header.root) {
+        munmap(image, bytes);
+        return false;
+    }
+
+    attach_nodes(tree, header, nodes);
+    tree.image = image;
+    tree.imageBytes = bytes;
+    return true;
+}
+
+void close_tree_image(MerkleTree& tree) {
+    if (tree.image) munmap(tree.image, tree.imageBytes);
+    tree.image = nullptr;
+    tree.imageBytes = 0;
+}
+
+#endif
@@ -0,0 +1,195 @@
+#include "tree_versions.h"
+#include <algorithm>
+#include <cstring>
+
+static size_t store_level_size(const VersionStore& store, size_t level) {
+    return (store.leafCount + ((size_t)1 << level) - 1) >> level;
+}
+
+// Digest of the node at (level, index) given its overlay node, if any
+static const Digest& hash_at(const VersionStore& store, const VersionNode* node, size_t level, size_t index) {
+    return node ? node->hash : store.baseNodes[store.levelOffsets[level] + index];
+}
+
+static VersionNode* alloc_node(VersionStore& store) {
+    VersionNode* node = store.freeList;
+    if (node) store.freeList = node->child[0];
+    else node = (VersionNode*)arena_alloc(store.arena, sizeof(VersionNode), alignof(VersionNode));
+
+    node->child[0] = nullptr;
+    node->child[1] = nullptr;
+    node->refs = 1;
+    store.liveNodes++;
+    return node;
+}
+
+static void unref_node(VersionStore& store, VersionNode* node) {
+    if (!node || --node->refs > 0) return;
+    unref_node(store, node->child[0]);
+    unref_node(store, node->child[1]);
+    node->child[0] = store.freeList;
+    store.freeList = node;
+    store.liveNodes--;
+}
+
+void init_version_store(VersionStore& store, const MerkleTree& tree) {
+    free_version_store(store);
+    if (tree.nodeCount == 0) return;
+
+    store.baseNodes = tree.nodes;
+    store.levelOffsets = tree.levelOffsets;
+    store.leafCount = tree.leafCount;
+    store.levelCount = tree.levelCount;
+    store.mode = tree.mode;
+    store.headId = store.nextId++;
+    store.versions.push_back({ store.headId, nullptr, get_merkle_root(tree) });
+}
+
+void free_version_store(VersionStore& store) {
+    arena_release(store.arena);
+    store.baseNodes = nullptr;
+    store.levelOffsets = nullptr;
+    store.levelCount = 0;
+    store.leafCount = 0;
+    store.versions.clear();
+    store.nextId = 0;
+    store.headId = 0;
+    store.freeList = nullptr;
+    store.liveNodes = 0;
+}
+
+const TreeVersion* find_version(const VersionStore& store, uint64_t id) {
+    for (const TreeVersion& version : store.versions)
+        if (version.id == id) return &version;
+    return nullptr;
+}
+
+const TreeVersion* latest_version(const VersionStore& store) {
+    return store.versions.empty() ? nullptr : &store.versions.back();
+}
+
+// Copy of the live tree's digests along the paths to the sorted, unique
+// leaves [leaves, leaves + count) below (level, index); off-path children
+// stay null
+static VersionNode* copy_live_paths(VersionStore& store, size_t level, size_t index, const size_t* leaves,
+    size_t count) {
+    VersionNode* node = alloc_node(store);
+    node->hash = store.baseNodes[store.levelOffsets[level] + index];
+    if (level == 0) return node;
+
+    size_t rightFirstLeaf = (2 * index + 1) << (level - 1);
+    size_t leftCount = lower_bound(leaves, leaves + count, rightFirstLeaf) - leaves;
+    if (leftCount > 0) node->child[0] = copy_live_paths(store, level - 1, 2 * index, leaves, leftCount);
+    if (leftCount < count)
+        node->child[1] = copy_live_paths(store, level - 1, 2 * index + 1, leaves + leftCount, count - leftCount);
+    return node;
+}
+
+// Make every null child of node that lies on a copied path point at the
+// copy. A null child meant "the live tree's node", and the copy holds that
+// same digest, so this is safe even for nodes other versions share.
+static void graft_paths(VersionNode* node, VersionNode* copy) {
+    for (size_t c = 0; c < 2; c++) {
+        VersionNode* copied = copy->child[c];
+        if (!copied || node->child[c] == copied) continue;
+        if (node->child[c]) {
+            graft_paths(node->child[c], copied);
+        }
+        else {
+            node->child[c] = copied;
+            copied->refs++;
+        }
+    }
+}
+
+bool commit_version(VersionStore& store, MerkleTree& tree, const pair<size_t, string>* updates, size_t count,
+    uint64_t& newId, unsigned threads) {
+    if (store.versions.empty() || store.baseNodes != tree.nodes || tree.leafIds.empty()) return false;
+    vector<size_t> leaves(count);
+    for (size_t k = 0; k < count; k++) {
+        if (updates[k].first >= store.leafCount) return false;
+        leaves[k] = updates[k].first;
+    }
+    sort(leaves.begin(), leaves.end());
+    leaves.erase(unique(leaves.begin(), leaves.end()), leaves.end());
+
+    // Older versions keep the digests the live tree is about to lose
+    if (!leaves.empty()) {
+        VersionNode* copy = copy_live_paths(store, store.levelCount - 1, 0, leaves.data(), leaves.size());
+        for (TreeVersion& version : store.versions) {
+            if (!version.root) {
+                version.root = copy;
+                copy->refs++;
+            }
+            else if (version.root != copy) {
+                graft_paths(version.root, copy);
+            }
+        }
+        unref_node(store, copy);
+        apply_updates(tree, updates, count, threads);
+    }
+
+    newId = store.nextId++;
+    store.headId = newId;
+    store.versions.push_back({ newId, nullptr, get_merkle_root(tree) });
+    return true;
+}
+
+bool release_version(VersionStore& store, uint64_t id) {
+    if (id == store.headId) return false;
+    for (size_t i = 0; i < store.versions.size(); i++) {
+        if (store.versions[i].id == id) {
+            unref_node(store, store.versions[i].root);
+            store.versions.erase(store.versions.begin() + i);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Overlay node on each level of the path to a leaf, top first; entries
+// below the first missing overlay are null
+static void version_path(const VersionStore& store, const TreeVersion& version, size_t index,
+    const VersionNode* path[64]) {
+    const VersionNode* node = version.root;
+    for (size_t level = store.levelCount; level-- > 0;) {
+        path[level] = node;
+        if (node && level > 0) node = node->child[(index >> (level - 1)) & 1];
+    }
+}
+
+Digest version_leaf(const VersionStore& store, uint64_t id, size_t index) {
+    const TreeVersion* version = find_version(store, id);
+    if (!version || index >= store.leafCount) return Digest{};
+
+    const VersionNode* path[64];
+    version_path(store, *version, index, path);
+    return hash_at(store, path[0], 0, index);
+}
+
+bool version_generate_proof(const VersionStore& store, uint64_t id, size_t index, ProofStep proof[],
+    size_t& proofLen) {
+    const TreeVersion* version = find_version(store, id);
+    if (!version || index >= store.leafCount) return false;
+
+    const VersionNode* path[64];
+    version_path(store, *version, index, path);
+
+    proofLen = 0;
+    for (size_t level = 0; level + 1 < store.levelCount; level++) {
+        size_t pos = index >> level;
+        size_t sibling = pos ^ 1;
+        if (sibling >= store_level_size(store, level)) continue; // promoted, no sibling
+
+        const VersionNode* parent = path[level + 1];
+        const VersionNode* siblingNode = parent ? parent->child[sibling & 1] : nullptr;
+        proof[proofLen].siblingHash = hash_at(store, siblingNode, level, sibling);
+        proof[proofLen].isLeft = (pos & 1) != 0;
+        proofLen++;
+    }
+    return true;
+}
+
+size_t version_store_memory_bytes(const VersionStore& store) {
+    return store.liveNodes * sizeof(VersionNode) + store.versions.capacity() * sizeof(TreeVersion);
+}
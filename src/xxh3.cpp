@@ -0,0 +1,302 @@
+#include "xxh3.h"
+#include <cstring>
+
+static const uint64_t PRIME32_1 = 0x9E3779B1U;
+static const uint64_t PRIME32_2 = 0x85EBCA77U;
+static const uint64_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+static const uint64_t PRIME_MX1 = 0x165667919E3779F9ULL;
+static const uint64_t PRIME_MX2 = 0x9FB21C651E98DF25ULL;
+
+static const size_t SECRET_SIZE = 192;
+static const size_t STRIPE_LEN = 64;
+
+static const uint8_t SECRET[SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+struct Hash128 {
+    uint64_t low;
+    uint64_t high;
+};
+
+static inline uint32_t read32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint64_t read64(const uint8_t* p) {
+    return (uint64_t)read32(p) | ((uint64_t)read32(p + 4) << 32);
+}
+
+static inline uint32_t swap32(uint32_t x) {
+    return ((x << 24) & 0xff000000) | ((x << 8) & 0x00ff0000) | ((x >> 8) & 0x0000ff00) | ((x >> 24) & 0x000000ff);
+}
+
+static inline uint64_t swap64(uint64_t x) {
+    return ((uint64_t)swap32((uint32_t)x) << 32) | swap32((uint32_t)(x >> 32));
+}
+
+static inline uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static inline Hash128 mult64to128(uint64_t a, uint64_t b) {
+    // Portable 64x64 -> 128 multiply from 32-bit halves
+    uint64_t loLo = (a & 0xFFFFFFFF) * (b & 0xFFFFFFFF);
+    uint64_t hiLo = (a >> 32) * (b & 0xFFFFFFFF);
+    uint64_t loHi = (a & 0xFFFFFFFF) * (b >> 32);
+    uint64_t hiHi = (a >> 32) * (b >> 32);
+    uint64_t cross = (loLo >> 32) + (hiLo & 0xFFFFFFFF) + loHi;
+    Hash128 r;
+    r.high = (hiLo >> 32) + (cross >> 32) + hiHi;
+    r.low = (cross << 32) | (loLo & 0xFFFFFFFF);
+    return r;
+}
+
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b) {
+    Hash128 p = mult64to128(a, b);
+    return p.low ^ p.high;
+}
+
+static inline uint64_t xorshift64(uint64_t v, int shift) {
+    return v ^ (v >> shift);
+}
+
+static inline uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= PRIME64_2;
+    h ^= h >> 29;
+    h *= PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t avalanche(uint64_t h) {
+    h = xorshift64(h, 37);
+    h *= PRIME_MX1;
+    h = xorshift64(h, 32);
+    return h;
+}
+
+static Hash128 len_1to3(const uint8_t* input, size_t len) {
+    uint8_t c1 = input[0];
+    uint8_t c2 = input[len >> 1];
+    uint8_t c3 = input[len - 1];
+    uint32_t combinedl = ((uint32_t)c1 << 16) | ((uint32_t)c2 << 24) | ((uint32_t)c3 << 0) | ((uint32_t)len << 8);
+    uint32_t combinedh = rotl32(swap32(combinedl), 13);
+    uint64_t bitflipl = read32(SECRET) ^ read32(SECRET + 4);
+    uint64_t bitfliph = read32(SECRET + 8) ^ read32(SECRET + 12);
+    Hash128 h;
+    h.low = xxh64_avalanche((uint64_t)combinedl ^ bitflipl);
+    h.high = xxh64_avalanche((uint64_t)combinedh ^ bitfliph);
+    return h;
+}
+
+static Hash128 len_4to8(const uint8_t* input, size_t len) {
+    uint32_t inputLo = read32(input);
+    uint32_t inputHi = read32(input + len - 4);
+    uint64_t input64 = inputLo + ((uint64_t)inputHi << 32);
+    uint64_t bitflip = read64(SECRET + 16) ^ read64(SECRET + 24);
+    uint64_t keyed = input64 ^ bitflip;
+
+    Hash128 m = mult64to128(keyed, PRIME64_1 + (len << 2));
+    m.high += (m.low << 1);
+    m.low ^= (m.high >> 3);
+    m.low = xorshift64(m.low, 35);
+    m.low *= PRIME_MX2;
+    m.low = xorshift64(m.low, 28);
+    m.high = avalanche(m.high);
+    return m;
+}
+
+static Hash128 len_9to16(const uint8_t* input, size_t len) {
+    uint64_t bitflipl = read64(SECRET + 32) ^ read64(SECRET + 40);
+    uint64_t bitfliph = read64(SECRET + 48) ^ read64(SECRET + 56);
+    uint64_t inputLo = read64(input);
+    uint64_t inputHi = read64(input + len - 8);
+
+    Hash128 m = mult64to128(inputLo ^ inputHi ^ bitflipl, PRIME64_1);
+    m.low += (uint64_t)(len - 1) << 54;
+    inputHi ^= bitfliph;
+    m.high += inputHi + (uint64_t)(uint32_t)inputHi * (PRIME32_2 - 1);
+    m.low ^= swap64(m.high);
+
+    Hash128 h = mult64to128(m.low, PRIME64_2);
+    h.high += m.high * PRIME64_2;
+    h.low = avalanche(h.low);
+    h.high = avalanche(h.high);
+    return h;
+}
+
+static inline uint64_t mix16(const uint8_t* input, const uint8_t* secret) {
+    return mul128_fold64(read64(input) ^ read64(secret), read64(input + 8) ^ read64(secret + 8));
+}
+
+static inline void mix32(Hash128& acc, const uint8_t* input1, const uint8_t* input2, const uint8_t* secret) {
+    acc.low += mix16(input1, secret);
+    acc.low ^= read64(input2) + read64(input2 + 8);
+    acc.high += mix16(input2, secret + 16);
+    acc.high ^= read64(input1) + read64(input1 + 8);
+}
+
+static Hash128 finish_mid(const Hash128& acc, size_t len) {
+    Hash128 h;
+    h.low = acc.low + acc.high;
+    h.high = (acc.low * PRIME64_1) + (acc.high * PRIME64_4) + ((uint64_t)len * PRIME64_2);
+    h.low = avalanche(h.low);
+    h.high = 0 - avalanche(h.high);
+    return h;
+}
+
+static Hash128 len_17to128(const uint8_t* input, size_t len) {
+    Hash128 acc = { len * PRIME64_1, 0 };
+    if (len > 32) {
+        if (len > 64) {
+            if (len > 96) mix32(acc, input + 48, input + len - 64, SECRET + 96);
+            mix32(acc, input + 32, input + len - 48, SECRET + 64);
+        }
+        mix32(acc, input + 16, input + len - 32, SECRET + 32);
+    }
+    mix32(acc, input, input + len - 16, SECRET);
+    return finish_mid(acc, len);
+}
+
+static Hash128 len_129to240(const uint8_t* input, size_t len) {
+    const size_t MIDSIZE_STARTOFFSET = 3;
+    const size_t MIDSIZE_LASTOFFSET = 17;
+    const size_t SECRET_SIZE_MIN = 136;
+
+    Hash128 acc = { len * PRIME64_1, 0 };
+    for (size_t i = 32; i < 160; i += 32)
+        mix32(acc, input + i - 32, input + i - 16, SECRET + i - 32);
+    acc.low = avalanche(acc.low);
+    acc.high = avalanche(acc.high);
+    for (size_t i = 160; i <= len; i += 32)
+        mix32(acc, input + i - 32, input + i - 16, SECRET + MIDSIZE_STARTOFFSET + i - 160);
+    mix32(acc, input + len - 16, input + len - 32, SECRET + SECRET_SIZE_MIN - MIDSIZE_LASTOFFSET - 16);
+    return finish_mid(acc, len);
+}
+
+static inline void accumulate_stripe(uint64_t acc[8], const uint8_t* input, const uint8_t* secret) {
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t dataVal = read64(input + 8 * i);
+        uint64_t dataKey = dataVal ^ read64(secret + 8 * i);
+        acc[i ^ 1] += dataVal;
+        acc[i] += (uint64_t)(uint32_t)dataKey * (dataKey >> 32);
+    }
+}
+
+static inline void scramble(uint64_t acc[8], const uint8_t* secret) {
+    for (size_t i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a = xorshift64(a, 47);
+        a ^= read64(secret + 8 * i);
+        a *= PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+static uint64_t merge_accs(const uint64_t acc[8], const uint8_t* secret, uint64_t start) {
+    uint64_t result = start;
+    for (size_t i = 0; i < 4; i++)
+        result += mul128_fold64(acc[2 * i] ^ read64(secret + 16 * i), acc[2 * i + 1] ^ read64(secret + 16 * i + 8));
+    return avalanche(result);
+}
+
+// Input made of two buffers read back to back (b may be empty)
+struct SplitInput {
+    const uint8_t* a;
+    size_t aLen;
+    const uint8_t* b;
+
+    // The stripe at off, copied into tmp only when it straddles the split
+    const uint8_t* stripe(size_t off, uint8_t* tmp) const {
+        if (off + STRIPE_LEN <= aLen) return a + off;
+        if (off >= aLen) return b + (off - aLen);
+        memcpy(tmp, a + off, aLen - off);
+        memcpy(tmp + (aLen - off), b, STRIPE_LEN - (aLen - off));
+        return tmp;
+    }
+};
+
+static Hash128 hash_long(const SplitInput& input, size_t len) {
+    const size_t SECRET_CONSUME_RATE = 8;
+    const size_t SECRET_LASTACC_START = 7;
+    const size_t SECRET_MERGEACCS_START = 11;
+
+    uint64_t acc[8] = { PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1 };
+    size_t stripesPerBlock = (SECRET_SIZE - STRIPE_LEN) / SECRET_CONSUME_RATE;
+    size_t blockLen = STRIPE_LEN * stripesPerBlock;
+    size_t blocks = (len - 1) / blockLen;
+
+    uint8_t tmp[STRIPE_LEN];
+    for (size_t n = 0; n < blocks; n++) {
+        for (size_t s = 0; s < stripesPerBlock; s++)
+            accumulate_stripe(acc, input.stripe(n * blockLen + s * STRIPE_LEN, tmp), SECRET + s * SECRET_CONSUME_RATE);
+        scramble(acc, SECRET + SECRET_SIZE - STRIPE_LEN);
+    }
+
+    size_t stripes = ((len - 1) - blockLen * blocks) / STRIPE_LEN;
+    for (size_t s = 0; s < stripes; s++)
+        accumulate_stripe(acc, input.stripe(blocks * blockLen + s * STRIPE_LEN, tmp), SECRET + s * SECRET_CONSUME_RATE);
+    accumulate_stripe(acc, input.stripe(len - STRIPE_LEN, tmp),
+        SECRET + SECRET_SIZE - STRIPE_LEN - SECRET_LASTACC_START);
+
+    Hash128 h;
+    h.low = merge_accs(acc, SECRET + SECRET_MERGEACCS_START, (uint64_t)len * PRIME64_1);
+    h.high = merge_accs(acc, SECRET + SECRET_SIZE - sizeof(acc) - SECRET_MERGEACCS_START,
+        ~((uint64_t)len * PRIME64_2));
+    return h;
+}
+
+static void store_digest(const Hash128& h, Digest& out) {
+    out.fill(0);
+    for (size_t i = 0; i < 8; i++) {
+        out[i] = (uint8_t)(h.high >> (56 - 8 * i));
+        out[8 + i] = (uint8_t)(h.low >> (56 - 8 * i));
+    }
+}
+
+void xxh3_128_digest(const uint8_t* data, size_t len, Digest& out) {
+    Hash128 h;
+    if (len == 0) {
+        h.low = xxh64_avalanche(read64(SECRET + 64) ^ read64(SECRET + 72));
+        h.high = xxh64_avalanche(read64(SECRET + 80) ^ read64(SECRET + 88));
+    }
+    else if (len <= 3) h = len_1to3(data, len);
+    else if (len <= 8) h = len_4to8(data, len);
+    else if (len <= 16) h = len_9to16(data, len);
+    else if (len <= 128) h = len_17to128(data, len);
+    else if (len <= 240) h = len_129to240(data, len);
+    else h = hash_long(SplitInput{ data, len, nullptr }, len);
+    store_digest(h, out);
+}
+
+// The short-input paths read from both ends at once, so those inputs are
+// joined in a stack buffer; longer ones are striped across the split
+void xxh3_128_digest_concat(const uint8_t* a, size_t aLen, const uint8_t* b, size_t bLen, Digest& out) {
+    size_t len = aLen + bLen;
+    if (len > 240) {
+        store_digest(hash_long(SplitInput{ a, aLen, b }, len), out);
+        return;
+    }
+    uint8_t joined[240];
+    if (aLen) memcpy(joined, a, aLen);
+    if (bLen) memcpy(joined + aLen, b, bLen);
+    xxh3_128_digest(joined, len, out);
+}
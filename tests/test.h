@@ -0,0 +1,37 @@
+#pragma once
+#include <string>
+#include <vector>
+#include "merkle_tree.h"
+using namespace std;
+
+// Minimal self-registering test runner. TEST(name) defines a case that
+// test_main.cpp runs; CHECK() records a failure with its location and
+// lets the case carry on.
+typedef void (*TestFn)();
+
+bool register_test(const char* name, TestFn fn);
+void record_failure(const char* file, int line, const char* expr);
+
+#define TEST(name) \
+    static void name(); \
+    [[maybe_unused]] static bool name##_registered = register_test(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) record_failure(__FILE__, __LINE__, #cond); } while (0)
+
+static const HashMode ALL_HASH_MODES[] = { HASH_MODE_HEX_CONCAT, HASH_MODE_BINARY, HASH_MODE_BLAKE3,
+    HASH_MODE_XXH3_128 };
+
+// n synthetic reviews with distinct IDs; some texts need JSON escaping
+void make_reviews(size_t n, vector<string>& ids, vector<string>& texts);
+// Path of a scratch file or directory under the system temp directory
+string temp_path(const string& name);
+// Writes the reviews as NDJSON and returns the file's path
+string write_dataset(const string& name, const vector<string>& ids, const vector<string>& texts);
+Digest digest_from_hex(const char* hex);
+// n reviews from make_reviews() and their tree
+void make_tree(MerkleTree& tree, vector<string>& ids, vector<string>& texts, size_t n, HashMode mode);
+// Straightforward level-by-level root: pair left to right, promote an odd
+// last node
+Digest reference_root(const vector<string>& ids, const vector<string>& texts, HashMode mode);
@@ -0,0 +1,65 @@
+#include "test.h"
+#include <cstdint>
+#include <cstring>
+
+TEST(arena_hands_out_aligned_disjoint_memory) {
+    Arena arena;
+    arena.blockSize = 4096;
+    vector<pair<uint8_t*, size_t>> spans;
+    for (size_t i = 0; i < 300; i++) {
+        size_t bytes = i * 37 % 500 + 1, align = (size_t)1 << (i % 8);
+        uint8_t* p = (uint8_t*)arena_alloc(arena, bytes, align);
+        CHECK((uintptr_t)p % align == 0);
+        memset(p, (int)i, bytes);
+        spans.push_back({ p, bytes });
+    }
+    // Later allocations never overwrote earlier ones
+    for (size_t i = 0; i < spans.size(); i++)
+        for (size_t j = 0; j < spans[i].second; j++) CHECK(spans[i].first[j] == (uint8_t)i);
+
+    // Larger than a block: it gets a block of its own
+    size_t blocks = arena.blocks;
+    CHECK(arena_alloc(arena, 10000, 64) != nullptr);
+    CHECK(arena.blocks == blocks + 1);
+    CHECK(arena.allocations == 301);
+    CHECK(arena.bytesUsed <= arena.bytesReserved);
+
+    int* numbers = arena_new_array<int>(arena, 10);
+    for (int i = 0; i < 10; i++) numbers[i] = i;
+    CHECK(numbers[9] == 9);
+
+    arena_release(arena);
+    CHECK(arena.head == nullptr && arena.blocks == 0 && arena.allocations == 0 && arena.bytesReserved == 0);
+}
+
+TEST(tree_storage_comes_from_its_arena) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 5000, HASH_MODE_BINARY);
+    CHECK(tree.arena.blocks > 0);
+    CHECK(tree.arena.bytesUsed >= tree.nodeCount * sizeof(Digest));
+    CHECK((uintptr_t)tree.nodes % 64 == 0);
+    free_merkle_tree(tree);
+    CHECK(tree.arena.blocks == 0 && tree.arena.bytesReserved == 0);
+
+    // A freed tree can be built again
+    init_merkle_tree(tree, ids.data(), texts.data(), ids.size());
+    CHECK(get_merkle_root(tree) == reference_root(ids, texts, HASH_MODE_BINARY));
+    free_merkle_tree(tree);
+}
+
+TEST(arena_counts_guaranteed_and_advised_huge_pages_apart) {
+    Arena plain, huge;
+    huge.hugePages = true;
+    for (int i = 0; i < 3; i++) {
+        CHECK(arena_alloc(plain, 3 << 20) != nullptr);
+        CHECK(arena_alloc(huge, 3 << 20) != nullptr);
+    }
+    CHECK(plain.hugeBlocks == 0 && plain.advisedBlocks == 0);
+    // Each block is either MAP_HUGETLB, merely advised, or a plain fallback
+    CHECK(huge.blocks == 3);
+    CHECK(huge.hugeBlocks + huge.advisedBlocks <= huge.blocks);
+    arena_release(huge);
+    CHECK(huge.hugeBlocks == 0 && huge.advisedBlocks == 0);
+    arena_release(plain);
+}
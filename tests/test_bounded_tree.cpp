@@ -0,0 +1,151 @@
+#include "test.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "bounded_tree.h"
+
+TEST(bounded_tree_matches_the_full_tree_in_every_mode) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        make_reviews(9000, ids, texts);
+        string path = write_dataset("bounded_modes.json", ids, texts);
+        Digest expected = reference_root(ids, texts, mode);
+        vector<Digest> leaves(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) leaves[i] = hash_leaf(ids[i], texts[i], mode);
+        LeafReader reader = [&](size_t first, size_t count, Digest* out) {
+            copy(leaves.begin() + first, leaves.begin() + first + count, out);
+            return true;
+        };
+
+        BoundedMerkleTree fromReader, fromFile;
+        CHECK(build_bounded_tree(fromReader, ids.size(), 16 * sizeof(Digest), reader, mode));
+        CHECK(build_bounded_tree_from_file(fromFile, path, 64 * sizeof(Digest), mode));
+        for (BoundedMerkleTree* tree : { &fromReader, &fromFile }) {
+            CHECK(tree->mode == mode && tree->leafCount == ids.size());
+            CHECK(bounded_root(*tree) == expected);
+            ProofStep proof[64];
+            size_t proofLen = 0;
+            Digest leaf{};
+            CHECK(bounded_generate_proof(*tree, 5000, proof, proofLen, &leaf));
+            CHECK(leaf == leaves[5000]);
+            CHECK(verify_proof(leaf, proof, proofLen, expected, mode));
+        }
+        free_bounded_tree(fromFile);
+        free_bounded_tree(fromReader);
+        filesystem::remove(path);
+    }
+}
+
+TEST(bounded_tree_proves_every_leaf_for_any_budget) {
+    for (size_t n : { 1, 2, 3, 4, 5, 7, 8, 9, 16, 17, 33, 100 }) {
+        vector<string> ids, texts;
+        make_reviews(n, ids, texts);
+        string path = write_dataset("bounded.json", ids, texts);
+        Digest expected = reference_root(ids, texts, HASH_MODE_BINARY);
+        vector<Digest> leaves(n);
+        for (size_t i = 0; i < n; i++) leaves[i] = hash_leaf(ids[i], texts[i]);
+        LeafReader reader = [&](size_t first, size_t count, Digest* out) {
+            copy(leaves.begin() + first, leaves.begin() + first + count, out);
+            return true;
+        };
+
+        for (size_t budget : { (size_t)0, sizeof(Digest), 5 * sizeof(Digest), 64 * sizeof(Digest), (size_t)1 << 30 }) {
+            BoundedMerkleTree fromReader, fromFile;
+            CHECK(build_bounded_tree(fromReader, n, budget, reader));
+            CHECK(build_bounded_tree_from_file(fromFile, path, budget));
+            for (BoundedMerkleTree* tree : { &fromReader, &fromFile }) {
+                CHECK(tree->residentLevel < tree->levelCount);
+                CHECK(bounded_root(*tree) == expected);
+                for (size_t i = 0; i < n; i++) {
+                    ProofStep proof[64];
+                    size_t proofLen = 0;
+                    Digest leaf{};
+                    CHECK(bounded_generate_proof(*tree, i, proof, proofLen, &leaf));
+                    CHECK(leaf == leaves[i]);
+                    CHECK(verify_proof(leaf, proof, proofLen, expected));
+                }
+            }
+            free_bounded_tree(fromFile);
+            free_bounded_tree(fromReader);
+        }
+        filesystem::remove(path);
+    }
+}
+
+TEST(bounded_tree_seeks_to_chunks_past_crlf_and_junk_lines) {
+    // Chunk offsets are summed from line lengths, so every kind of line
+    // ending and skipped line has to count exactly
+    vector<string> ids, texts;
+    make_reviews(300, ids, texts);
+    string path = write_dataset("bounded_crlf.json", ids, texts);
+    string original;
+    {
+        ifstream in(path, ios::binary);
+        original.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    }
+    string mixed;
+    size_t lineNo = 0;
+    for (size_t at = 0; at < original.size(); lineNo++) {
+        size_t end = original.find('\n', at);
+        mixed += original.substr(at, end - at);
+        mixed += lineNo % 3 == 0 ? "\r\n" : "\n";
+        if (lineNo % 7 == 0) mixed += "\nnot a record\r\n";
+        at = end + 1;
+    }
+    mixed.pop_back(); // no newline after the last record
+    ofstream(path, ios::binary) << mixed;
+
+    Digest expected = reference_root(ids, texts, HASH_MODE_BINARY);
+    BoundedMerkleTree tree;
+    CHECK(build_bounded_tree_from_file(tree, path, 0));
+    CHECK(bounded_root(tree) == expected);
+    for (size_t i = 0; i < ids.size(); i++) {
+        ProofStep proof[64];
+        size_t proofLen = 0;
+        Digest leaf{};
+        CHECK(bounded_generate_proof(tree, i, proof, proofLen, &leaf));
+        CHECK(leaf == hash_leaf(ids[i], texts[i]));
+        CHECK(verify_proof(leaf, proof, proofLen, expected));
+    }
+    free_bounded_tree(tree);
+    filesystem::remove(path);
+}
+
+TEST(bounded_tree_keeps_to_its_budget) {
+    vector<string> ids, texts;
+    make_reviews(4097, ids, texts);
+    vector<Digest> leaves(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) leaves[i] = hash_leaf(ids[i], texts[i]);
+    LeafReader reader = [&](size_t first, size_t count, Digest* out) {
+        copy(leaves.begin() + first, leaves.begin() + first + count, out);
+        return true;
+    };
+
+    // Everything fits, nothing but the root fits, and a budget in between
+    CHECK(resident_level_for_budget(4097, (size_t)1 << 30) == 0);
+    CHECK(resident_level_for_budget(4097, 0) == 13);
+    size_t level = resident_level_for_budget(4097, 100 * sizeof(Digest));
+    BoundedMerkleTree tree;
+    CHECK(build_bounded_tree(tree, ids.size(), 100 * sizeof(Digest), reader));
+    CHECK(tree.residentLevel == level);
+    CHECK(tree.nodes.size() * sizeof(Digest) <= 100 * sizeof(Digest));
+
+    // A proof regenerates exactly one chunk of leaves
+    ProofStep proof[64];
+    size_t proofLen = 0;
+    CHECK(bounded_generate_proof(tree, 1234, proof, proofLen));
+    CHECK(tree.leavesRehashed == (size_t)1 << level);
+    CHECK(bounded_generate_proof(tree, 4096, proof, proofLen));
+    CHECK(tree.leavesRehashed == ((size_t)1 << level) + 1);
+    CHECK(!bounded_generate_proof(tree, 4097, proof, proofLen));
+
+    // A source that changed under the tree no longer matches its chunk root
+    leaves[1234][0] ^= 1;
+    CHECK(!bounded_generate_proof(tree, 1234, proof, proofLen));
+    free_bounded_tree(tree);
+
+    // Build failures: an unreadable source or a missing file
+    LeafReader failing = [](size_t, size_t, Digest*) { return false; };
+    CHECK(!build_bounded_tree(tree, ids.size(), 0, failing));
+    CHECK(!build_bounded_tree_from_file(tree, temp_path("missing.json"), 0));
+}
@@ -0,0 +1,102 @@
+#include "test.h"
+#include <algorithm>
+
+static const size_t SIZES[] = { 1, 2, 3, 5, 8, 13, 64, 100, 1000, 4097 };
+
+TEST(levels_are_stored_back_to_back) {
+    for (size_t n : SIZES) {
+        vector<string> ids, texts;
+        MerkleTree tree;
+        make_tree(tree, ids, texts, n, HASH_MODE_BINARY);
+
+        size_t expectedLevels = 1;
+        while (((n - 1) >> (expectedLevels - 1)) > 0) expectedLevels++;
+        CHECK(tree.levelCount == expectedLevels);
+        CHECK(tree.levelOffsets[0] == 0);
+        for (size_t level = 0; level + 1 < tree.levelCount; level++) {
+            CHECK(level_size(tree, level) == (n + ((size_t)1 << level) - 1) >> level);
+            CHECK(tree.levelOffsets[level + 1] == tree.levelOffsets[level] + level_size(tree, level));
+        }
+        CHECK(level_size(tree, tree.levelCount - 1) == 1);
+        CHECK(tree.nodeCount == tree.levelOffsets[tree.levelCount - 1] + 1);
+        CHECK(get_merkle_root(tree) == tree.nodes[tree.nodeCount - 1]);
+
+        // Leaves in input order, then node i of level l from 2i and 2i+1
+        // below, the odd last one promoted
+        for (size_t i = 0; i < n; i++) CHECK(tree.nodes[i] == hash_leaf(ids[i], texts[i]));
+        for (size_t level = 1; level < tree.levelCount; level++) {
+            size_t below = level_size(tree, level - 1);
+            for (size_t i = 0; i < level_size(tree, level); i++) {
+                Digest expected = node_hash(tree, level - 1, 2 * i);
+                if (2 * i + 1 < below)
+                    hash_node(node_hash(tree, level - 1, 2 * i), node_hash(tree, level - 1, 2 * i + 1), expected,
+                        tree.mode);
+                CHECK(node_hash(tree, level, i) == expected);
+            }
+        }
+        CHECK(get_merkle_root(tree) == reference_root(ids, texts, HASH_MODE_BINARY));
+        free_merkle_tree(tree);
+    }
+}
+
+TEST(tree_is_independent_of_thread_count) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t n : SIZES) {
+            vector<string> ids, texts;
+            MerkleTree serial;
+            make_tree(serial, ids, texts, n, mode);
+            CHECK(get_merkle_root(serial) == reference_root(ids, texts, mode));
+
+            // Worker blocks split the leaves at different levels for each
+            // count; every node, not just the root, has to come out the same
+            for (unsigned threads : { 2u, 3u, 4u, 7u, 0u }) {
+                MerkleTree tree;
+                init_merkle_tree(tree, ids.data(), texts.data(), n, mode, threads);
+                CHECK(tree.leafCount == n && tree.nodeCount == serial.nodeCount);
+                CHECK(equal(tree.nodes, tree.nodes + tree.nodeCount, serial.nodes));
+                size_t index = 0;
+                CHECK(find_leaf_by_id(tree, ids[n - 1], index) && index == n - 1);
+
+                build_tree(tree, threads);
+                CHECK(equal(tree.nodes, tree.nodes + tree.nodeCount, serial.nodes));
+                free_merkle_tree(tree);
+            }
+            free_merkle_tree(serial);
+        }
+    }
+}
+
+TEST(compute_root_matches_the_tree) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t n : SIZES) {
+            vector<string> ids, texts;
+            make_reviews(n, ids, texts);
+            Digest expected = reference_root(ids, texts, mode);
+
+            vector<Digest> leaves(n);
+            for (size_t i = 0; i < n; i++) leaves[i] = hash_leaf(ids[i], texts[i], mode);
+            CHECK(compute_root(leaves.data(), n, mode) == expected);
+        }
+    }
+}
+
+TEST(memory_estimate_counts_short_heap_ids) {
+    // 21-character IDs are past libstdc++'s 15-character inline buffer but
+    // shorter than sizeof(string); each one owns a heap buffer
+    vector<string> ids(1000), texts(1000, "t");
+    for (size_t i = 0; i < ids.size(); i++) {
+        ids[i] = "id-" + to_string(100000000000000000ull + i);
+        CHECK(ids[i].size() == 21);
+    }
+    vector<string> shortIds(1000);
+    for (size_t i = 0; i < shortIds.size(); i++) shortIds[i] = to_string(i);
+
+    MerkleTree longTree, shortTree;
+    init_merkle_tree(longTree, ids.data(), texts.data(), ids.size());
+    init_merkle_tree(shortTree, shortIds.data(), texts.data(), shortIds.size());
+    size_t inlineLimit = string().capacity();
+    if (ids[0].size() > inlineLimit)
+        CHECK(merkle_tree_memory_bytes(longTree) >= merkle_tree_memory_bytes(shortTree) + ids.size() * 22);
+    free_merkle_tree(shortTree);
+    free_merkle_tree(longTree);
+}
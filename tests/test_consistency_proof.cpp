@@ -0,0 +1,68 @@
+#include "test.h"
+#include <cmath>
+#include "consistency_proof.h"
+
+TEST(consistency_proofs_round_trip) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        MerkleTree tree;
+        make_tree(tree, ids, texts, 70, mode);
+        Digest newRoot = get_merkle_root(tree);
+        for (size_t oldSize = 1; oldSize <= 70; oldSize++) {
+            MerkleTree older;
+            init_merkle_tree(older, ids.data(), texts.data(), oldSize, mode);
+            Digest oldRoot = get_merkle_root(older);
+            free_merkle_tree(older);
+
+            vector<Digest> proof;
+            CHECK(generate_consistency_proof(tree, oldSize, proof));
+            CHECK(verify_consistency_proof(oldRoot, oldSize, newRoot, 70, proof, mode));
+
+            // Swapped roots, an impossible size or a tampered digest are
+            // rejected. (Sizes only fix the proof's shape, so another
+            // newSize with the same shape may still verify.)
+            if (oldSize < 70) CHECK(!verify_consistency_proof(newRoot, oldSize, oldRoot, 70, proof, mode));
+            CHECK(!verify_consistency_proof(oldRoot, 71, newRoot, 70, proof, mode));
+            if (!proof.empty()) {
+                proof.back()[5] ^= 2;
+                CHECK(!verify_consistency_proof(oldRoot, oldSize, newRoot, 70, proof, mode));
+            }
+        }
+        vector<Digest> proof;
+        CHECK(!generate_consistency_proof(tree, 0, proof));
+        CHECK(!generate_consistency_proof(tree, 71, proof));
+        free_merkle_tree(tree);
+    }
+}
+
+TEST(consistency_proofs_stay_logarithmic) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 5000, HASH_MODE_BINARY);
+    Digest newRoot = get_merkle_root(tree);
+    size_t bound = 2 * (size_t)ceil(log2(5000.0));
+    for (size_t oldSize : { (size_t)1, (size_t)2, (size_t)1023, (size_t)1024, (size_t)1025, (size_t)4096,
+             (size_t)4999, (size_t)5000 }) {
+        MerkleTree older;
+        init_merkle_tree(older, ids.data(), texts.data(), oldSize, HASH_MODE_BINARY);
+        Digest oldRoot = get_merkle_root(older);
+        free_merkle_tree(older);
+
+        vector<Digest> proof;
+        CHECK(generate_consistency_proof(tree, oldSize, proof));
+        CHECK(proof.size() <= bound);
+        CHECK((oldSize == 5000) == proof.empty());
+        CHECK(verify_consistency_proof(oldRoot, oldSize, newRoot, 5000, proof));
+        // Another hash mode, a dropped or an extra digest all fail
+        CHECK(!verify_consistency_proof(oldRoot, oldSize, newRoot, 5000, proof, HASH_MODE_BLAKE3) ||
+            proof.empty());
+        if (!proof.empty()) {
+            vector<Digest> shorter(proof.begin(), proof.end() - 1);
+            CHECK(!verify_consistency_proof(oldRoot, oldSize, newRoot, 5000, shorter));
+        }
+        vector<Digest> longer = proof;
+        longer.push_back(newRoot);
+        CHECK(!verify_consistency_proof(oldRoot, oldSize, newRoot, 5000, longer));
+    }
+    free_merkle_tree(tree);
+}
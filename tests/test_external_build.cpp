@@ -0,0 +1,118 @@
+#include "test.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include "external_build.h"
+
+static const size_t SIZES[] = { 1, 2, 3, 5, 8, 13, 64, 100, 1000, 4097 };
+
+TEST(external_build_matches_the_in_memory_root) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t n : SIZES) {
+            vector<string> ids, texts;
+            make_reviews(n, ids, texts);
+            Digest expected = reference_root(ids, texts, mode);
+
+            // Small buffers so the level files take several passes
+            string dir = temp_path("external");
+            filesystem::create_directories(dir);
+            ExternalTreeBuilder builder;
+            CHECK(init_external_builder(builder, dir, mode, 4096, 2));
+            external_append_chunk(builder, ids.data(), texts.data(), n / 3);
+            for (size_t i = n / 3; i < n; i++) external_append(builder, ids[i], texts[i]);
+            Digest root{};
+            CHECK(finish_external_build(builder, root));
+            CHECK(root == expected);
+            filesystem::remove_all(dir);
+        }
+    }
+}
+
+TEST(kept_level_files_hold_the_tree_levels) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 3001, HASH_MODE_XXH3_128);
+    string dir = temp_path("kept");
+    filesystem::create_directories(dir);
+
+    // Leaves handed in one at a time, as digests, across three threads
+    ExternalTreeBuilder builder;
+    builder.keepLevelFiles = true;
+    CHECK(init_external_builder(builder, dir, HASH_MODE_XXH3_128, 4096, 3));
+    for (size_t i = 0; i < tree.leafCount; i++) external_append_leaf(builder, tree.nodes[i]);
+    Digest root{};
+    CHECK(finish_external_build(builder, root));
+    CHECK(root == get_merkle_root(tree));
+    CHECK(builder.leafCount == tree.leafCount && builder.levelCount == tree.levelCount);
+    CHECK(builder.bytesWritten == tree.nodeCount * sizeof(Digest));
+
+    for (size_t level = 0; level < tree.levelCount; level++) {
+        ifstream in(external_level_path(dir, level), ios::binary);
+        vector<Digest> stored(level_size(tree, level) + 1);
+        in.read((char*)stored.data(), stored.size() * sizeof(Digest));
+        CHECK((size_t)in.gcount() == level_size(tree, level) * sizeof(Digest));
+        CHECK(equal(stored.begin(), stored.end() - 1, tree.nodes + tree.levelOffsets[level]));
+    }
+    filesystem::remove_all(dir);
+    free_merkle_tree(tree);
+}
+
+TEST(external_build_removes_level_files_on_every_path) {
+    vector<string> ids, texts;
+    make_reviews(1000, ids, texts);
+    Digest expected = reference_root(ids, texts, HASH_MODE_BINARY);
+    auto build = [&](const string& dir, bool keep, Digest& root) {
+        ExternalTreeBuilder builder;
+        builder.keepLevelFiles = keep;
+        CHECK(init_external_builder(builder, dir, HASH_MODE_BINARY, 4096, 3));
+        external_append_chunk(builder, ids.data(), texts.data(), ids.size());
+        return finish_external_build(builder, root);
+    };
+    auto files_in = [](const string& dir) {
+        size_t files = 0;
+        for (auto& entry : filesystem::directory_iterator(dir)) files += entry.is_regular_file();
+        return files;
+    };
+
+    string dir = temp_path("levels");
+    filesystem::create_directories(dir);
+    Digest root{};
+    CHECK(build(dir, false, root) && root == expected);
+    CHECK(files_in(dir) == 0);
+
+    // 1000 leaves make 11 levels
+    CHECK(build(dir, true, root) && root == expected);
+    CHECK(files_in(dir) == 11);
+    filesystem::remove_all(dir);
+
+    // level_3.bin cannot be created, so the build stops part way; nothing
+    // is left behind even though the files were to be kept
+    filesystem::create_directories(dir + "/level_3.bin/blocker");
+    CHECK(!build(dir, true, root));
+    CHECK(files_in(dir) == 0);
+
+    ExternalTreeBuilder empty;
+    CHECK(init_external_builder(empty, dir));
+    CHECK(!finish_external_build(empty, root));
+    CHECK(files_in(dir) == 0);
+    filesystem::remove_all(dir);
+}
+
+TEST(external_build_counts_only_bytes_actually_written) {
+    // Every write to /dev/full fails with ENOSPC
+    if (!filesystem::exists("/dev/full")) return;
+    string dir = temp_path("full");
+    filesystem::create_directories(dir);
+    filesystem::create_symlink("/dev/full", external_level_path(dir, 0));
+
+    vector<string> ids, texts;
+    make_reviews(500, ids, texts);
+    ExternalTreeBuilder builder;
+    CHECK(init_external_builder(builder, dir, HASH_MODE_BINARY, 4096));
+    external_append_chunk(builder, ids.data(), texts.data(), ids.size());
+    Digest root{};
+    CHECK(!finish_external_build(builder, root));
+    CHECK(builder.failed);
+    CHECK(builder.bytesWritten == 0);
+    filesystem::remove_all(dir);
+}
@@ -0,0 +1,270 @@
+#include "test.h"
+#include <algorithm>
+#include <cctype>
+#include "blake3.h"
+#include "xxh3.h"
+
+static vector<uint8_t> pattern_bytes(size_t n) {
+    vector<uint8_t> bytes(n);
+    for (size_t i = 0; i < n; i++) bytes[i] = (uint8_t)(i % 251);
+    return bytes;
+}
+
+static Digest picosha2_digest(const uint8_t* data, size_t len) {
+    Digest out;
+    picosha2::hash256(data, data + len, out.begin(), out.end());
+    return out;
+}
+
+TEST(digests_are_raw_bytes_until_shown_as_hex) {
+    static_assert(sizeof(Digest) == 32, "a digest is 32 raw bytes");
+    const string hex = "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad";
+    Digest abc;
+    sha256_digest((const uint8_t*)"abc", 3, abc);
+    CHECK(abc[0] == 0xba && abc[31] == 0xad);
+    CHECK(digest_to_hex(abc) == hex);
+
+    Digest parsed{};
+    CHECK(hex_to_digest(hex, parsed) && parsed == abc);
+    string upper = hex;
+    for (char& c : upper) c = (char)toupper((unsigned char)c);
+    CHECK(hex_to_digest(upper, parsed) && parsed == abc);
+
+    // Wrong length or a non-hex character
+    CHECK(!hex_to_digest(hex.substr(1), parsed));
+    CHECK(!hex_to_digest(hex + "0", parsed));
+    string bad = hex;
+    bad[10] = 'g';
+    CHECK(!hex_to_digest(bad, parsed));
+
+    // Binary-mode nodes hash the two 32-byte children directly
+    Digest left = abc, right{}, node, expected;
+    uint8_t joined[64];
+    copy(left.begin(), left.end(), joined);
+    copy(right.begin(), right.end(), joined + 32);
+    sha256_digest(joined, sizeof(joined), expected);
+    hash_node(left, right, node, HASH_MODE_BINARY);
+    CHECK(node == expected);
+}
+
+TEST(sha256_matches_reference_vectors) {
+    Digest out;
+    sha256_digest((const uint8_t*)"abc", 3, out);
+    CHECK(out == digest_from_hex("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    sha256_digest(nullptr, 0, out);
+    CHECK(out == digest_from_hex("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+}
+
+TEST(sha256_backends_agree_with_picosha2) {
+    vector<uint8_t> bytes = pattern_bytes(1100);
+    const Sha256Backend* shani = sha256_shani_backend();
+    for (size_t len = 0; len < bytes.size(); len += 13) {
+        Digest expected = picosha2_digest(bytes.data(), len), out;
+        sha256_digest_with(sha256_portable_backend(), bytes.data(), len, out);
+        CHECK(out == expected);
+        if (shani) {
+            sha256_digest_with(*shani, bytes.data(), len, out);
+            CHECK(out == expected);
+        }
+
+        // Incremental, fed in uneven pieces
+        Sha256State state;
+        sha256_init(state);
+        for (size_t at = 0; at < len;) {
+            size_t piece = min(len - at, at % 70 + 1);
+            sha256_update(state, bytes.data() + at, piece);
+            at += piece;
+        }
+        sha256_final(state, out);
+        CHECK(out == expected);
+    }
+}
+
+TEST(sha256_dispatch_prefers_sha_ni) {
+    const Sha256Backend* shani = sha256_shani_backend();
+    const Sha256Backend& portable = sha256_portable_backend();
+    CHECK(&sha256_backend() == (shani ? shani : &portable));
+    Sha256State state;
+    sha256_init(state);
+    CHECK(state.backend == &sha256_backend());
+    if (!shani) return;
+
+    // Several blocks per call, from the standard initial state
+    CHECK(string(shani->name) != portable.name);
+    vector<uint8_t> blocks = pattern_bytes(64 * 5);
+    const uint32_t iv[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab,
+        0x5be0cd19 };
+    uint32_t a[8], b[8];
+    copy(iv, iv + 8, a);
+    copy(iv, iv + 8, b);
+    shani->compress(a, blocks.data(), 5);
+    portable.compress(b, blocks.data(), 5);
+    CHECK(equal(a, a + 8, b));
+}
+
+TEST(sha256_multi_matches_single_message) {
+    // Lengths around the one- and two-block padding limits; counts that
+    // leave partial groups of 8 and 16 lanes
+    for (size_t len : { (size_t)0, (size_t)55, (size_t)56, (size_t)64, (size_t)119, (size_t)128, (size_t)200 }) {
+        for (size_t count : { (size_t)1, (size_t)7, (size_t)16, (size_t)37 }) {
+            vector<vector<uint8_t>> messages(count, pattern_bytes(max<size_t>(len, 1)));
+            vector<const uint8_t*> pointers(count);
+            for (size_t i = 0; i < count; i++) {
+                messages[i][0] = (uint8_t)i;
+                pointers[i] = messages[i].data();
+            }
+            for (unsigned lanes : { 1u, 8u, 0u }) {
+                vector<Digest> digests(count);
+                sha256_multi(pointers.data(), len, count, digests.data(), lanes);
+                for (size_t i = 0; i < count; i++) CHECK(digests[i] == picosha2_digest(pointers[i], len));
+            }
+        }
+    }
+    CHECK(sha256_multi_lanes() >= 1);
+}
+
+TEST(pair_hashing_matches_hash_node) {
+    vector<Digest> children(2 * 41);
+    for (size_t i = 0; i < children.size(); i++) sha256_digest((const uint8_t*)&i, sizeof(i), children[i]);
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t count : { (size_t)0, (size_t)1, (size_t)15, (size_t)16, (size_t)17, (size_t)41 }) {
+            vector<Digest> parents(count + 1);
+            parents[count][0] = 0x5a; // must stay untouched
+            with_hash_policy(mode, [&](auto policy) {
+                decltype(policy)::hash_pairs(children.data(), count, parents.data());
+            });
+            for (size_t k = 0; k < count; k++) {
+                Digest expected;
+                hash_node(children[2 * k], children[2 * k + 1], expected, mode);
+                CHECK(parents[k] == expected);
+            }
+            CHECK(parents[count][0] == 0x5a);
+        }
+    }
+}
+
+TEST(hash_policies_match_their_runtime_modes) {
+    vector<string> ids, texts;
+    make_reviews(300, ids, texts);
+    vector<Digest> roots;
+    for (HashMode mode : ALL_HASH_MODES) {
+        MerkleTree runtime, compiled;
+        init_merkle_tree(runtime, ids.data(), texts.data(), ids.size(), mode);
+        with_hash_policy(mode, [&](auto policy) {
+            typedef decltype(policy) Policy;
+            CHECK(Policy::mode == mode);
+            init_merkle_tree<Policy>(compiled, ids.data(), texts.data(), ids.size());
+        });
+        CHECK(compiled.mode == mode);
+        CHECK(equal(compiled.nodes, compiled.nodes + compiled.nodeCount, runtime.nodes));
+        roots.push_back(get_merkle_root(runtime));
+
+        HashMode parsed;
+        CHECK(hash_mode_from_version(mode, parsed) && parsed == mode);
+        CHECK(string(hash_mode_name(mode)) != "unknown");
+        free_merkle_tree(compiled);
+        free_merkle_tree(runtime);
+    }
+    for (size_t a = 0; a < roots.size(); a++)
+        for (size_t b = a + 1; b < roots.size(); b++) CHECK(roots[a] != roots[b]);
+
+    // Unknown modes fall back to binary SHA-256 and are never parsed
+    CHECK(with_hash_policy((HashMode)99, [](auto policy) { return decltype(policy)::mode; }) == HASH_MODE_BINARY);
+    HashMode parsed;
+    CHECK(!hash_mode_from_version(0, parsed));
+    CHECK(!hash_mode_from_version(5, parsed));
+
+    // XXH3 digests are 16 bytes, zero-padded in leaves and nodes alike
+    Digest leaf = hash_leaf(ids[0], texts[0], HASH_MODE_XXH3_128), node;
+    hash_node(leaf, leaf, node, HASH_MODE_XXH3_128);
+    for (size_t i = 16; i < 32; i++) CHECK(leaf[i] == 0 && node[i] == 0);
+}
+
+TEST(blake3_matches_reference_vectors) {
+    vector<uint8_t> bytes = pattern_bytes(3000);
+    Digest out;
+    blake3_digest(nullptr, 0, out);
+    CHECK(out == digest_from_hex("af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262"));
+    blake3_digest((const uint8_t*)"abc", 3, out);
+    CHECK(out == digest_from_hex("6437b3ac38465133ffb63b75273a8db548c558465d79db03fd359c6cd5bd9d85"));
+    blake3_digest(bytes.data(), bytes.size(), out);
+    CHECK(out == digest_from_hex("5fade288bf27444bee55ba2babb98c3c922c1e84c2e445e7d1f6da24756f5060"));
+
+    Blake3Hasher hasher;
+    blake3_init(hasher);
+    for (size_t at = 0; at < bytes.size(); at += 97)
+        blake3_update(hasher, bytes.data() + at, min<size_t>(97, bytes.size() - at));
+    Digest incremental;
+    blake3_final(hasher, incremental);
+    CHECK(incremental == out);
+}
+
+TEST(xxh3_128_matches_reference_vectors) {
+    vector<uint8_t> bytes = pattern_bytes(3000);
+    Digest out;
+    xxh3_128_digest(nullptr, 0, out);
+    CHECK(out == digest_from_hex("99aa06d3014798d86001c324468d497f"));
+    xxh3_128_digest((const uint8_t*)"abc", 3, out);
+    CHECK(out == digest_from_hex("06b05ab6733a618578af5f94892f3950"));
+    xxh3_128_digest(bytes.data(), bytes.size(), out);
+    CHECK(out == digest_from_hex("d324b9e72fa9fb271b846747012c24aa"));
+}
+
+TEST(concat_hashing_matches_joined_input) {
+    vector<uint8_t> bytes = pattern_bytes(2100);
+    for (size_t total : { (size_t)0, (size_t)17, (size_t)240, (size_t)241, (size_t)1000, (size_t)2100 }) {
+        for (size_t split = 0; split <= total; split += total / 5 + 1) {
+            Digest joined, split2;
+            xxh3_128_digest(bytes.data(), total, joined);
+            xxh3_128_digest_concat(bytes.data(), split, bytes.data() + split, total - split, split2);
+            CHECK(joined == split2);
+        }
+    }
+
+    // hash_leaf hashes the two spans without joining them
+    vector<string> ids, texts;
+    make_reviews(40, ids, texts);
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t i = 0; i < ids.size(); i++) {
+            string joined = ids[i] + texts[i];
+            Digest expected;
+            with_hash_policy(mode, [&](auto policy) {
+                decltype(policy)::hash((const uint8_t*)joined.data(), joined.size(), expected);
+            });
+            CHECK(hash_leaf(ids[i], texts[i], mode) == expected);
+        }
+    }
+}
+
+TEST(leaf_hashing_splits_at_every_block_boundary) {
+    // Lengths around the SHA-256 block (64), the XXH3 short-input limits
+    // (16, 128, 240) and the BLAKE3 chunk (1024), on either side of the split
+    const size_t lengths[] = { 0, 1, 15, 16, 17, 55, 56, 63, 64, 65, 127, 128, 129, 239, 240, 241, 1023, 1024, 1025 };
+    vector<uint8_t> bytes = pattern_bytes(2 * 1025);
+    for (HashMode mode : ALL_HASH_MODES) {
+        with_hash_policy(mode, [&](auto policy) {
+            typedef decltype(policy) Policy;
+            for (size_t aLen : lengths) {
+                for (size_t bLen : lengths) {
+                    Digest joined, split;
+                    Policy::hash(bytes.data(), aLen + bLen, joined);
+                    Policy::hash_concat(bytes.data(), aLen, bytes.data() + aLen, bLen, split);
+                    CHECK(joined == split);
+                }
+            }
+        });
+
+        // Empty IDs and texts, and a review far larger than any internal buffer
+        string big((size_t)1 << 20, 'r');
+        for (size_t i = 0; i < big.size(); i += 97) big[i] = (char)('a' + i % 26);
+        for (const auto& leaf : vector<pair<string, string>>{ { "", "" }, { "id", "" }, { "", "text" },
+                 { "R1", big }, { big, "x" } }) {
+            string joined = leaf.first + leaf.second;
+            Digest expected;
+            with_hash_policy(mode, [&](auto policy) {
+                decltype(policy)::hash((const uint8_t*)joined.data(), joined.size(), expected);
+            });
+            CHECK(hash_leaf(leaf.first, leaf.second, mode) == expected);
+        }
+    }
+}
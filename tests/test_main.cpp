@@ -0,0 +1,92 @@
+#include "test.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include "json.hpp"
+
+struct TestCase {
+    const char* name;
+    TestFn fn;
+};
+
+static vector<TestCase>& registry() {
+    static vector<TestCase> tests;
+    return tests;
+}
+
+static size_t failures = 0;
+
+bool register_test(const char* name, TestFn fn) {
+    registry().push_back({ name, fn });
+    return true;
+}
+
+void record_failure(const char* file, int line, const char* expr) {
+    printf("  %s:%d: CHECK(%s) failed\n", file, line, expr);
+    failures++;
+}
+
+void make_reviews(size_t n, vector<string>& ids, vector<string>& texts) {
+    ids.resize(n);
+    texts.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        ids[i] = "R" + to_string(i * 7919 % 1000003);
+        texts[i] = "review " + to_string(i);
+        if (i % 5 == 1) texts[i] += " said \"fine\"\tand left\n";
+        if (i % 7 == 2) texts[i] += " caf\xc3\xa9 \xe2\x82\xac";
+        if (i % 11 == 3) texts[i] += string(300, 'x');
+    }
+}
+
+string temp_path(const string& name) {
+    return (filesystem::temp_directory_path() / ("merkle_tests_" + name)).string();
+}
+
+string write_dataset(const string& name, const vector<string>& ids, const vector<string>& texts) {
+    string path = temp_path(name);
+    ofstream out(path, ios::binary);
+    for (size_t i = 0; i < ids.size(); i++)
+        out << nlohmann::json{ { "reviewID", ids[i] }, { "reviewText", texts[i] } }.dump() << "\n";
+    return path;
+}
+
+Digest digest_from_hex(const char* hex) {
+    // Short (XXH3) digests are zero-padded to the full 32 bytes
+    string full(hex);
+    full.resize(64, '0');
+    Digest digest{};
+    hex_to_digest(full, digest);
+    return digest;
+}
+
+void make_tree(MerkleTree& tree, vector<string>& ids, vector<string>& texts, size_t n, HashMode mode) {
+    make_reviews(n, ids, texts);
+    init_merkle_tree(tree, ids.data(), texts.data(), n, mode);
+}
+
+Digest reference_root(const vector<string>& ids, const vector<string>& texts, HashMode mode) {
+    vector<Digest> level(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) level[i] = hash_leaf(ids[i], texts[i], mode);
+    while (level.size() > 1) {
+        vector<Digest> next((level.size() + 1) / 2);
+        for (size_t i = 0; i + 1 < level.size(); i += 2) hash_node(level[i], level[i + 1], next[i / 2], mode);
+        if (level.size() % 2) next.back() = level.back();
+        level.swap(next);
+    }
+    return level[0];
+}
+
+// Runs every test, or those whose name contains the first argument
+int main(int argc, char** argv) {
+    size_t run = 0;
+    for (const TestCase& test : registry()) {
+        if (argc > 1 && !strstr(test.name, argv[1])) continue;
+        size_t before = failures;
+        test.fn();
+        printf("%s %s\n", failures == before ? "PASS" : "FAIL", test.name);
+        run++;
+    }
+    printf("%zu tests, %zu failed checks\n", run, failures);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+#include "test.h"
+#include "merkle_stream.h"
+
+TEST(stream_root_matches_the_tree) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t n : { 1, 2, 3, 5, 8, 13, 64, 100, 1000, 4097 }) {
+            vector<string> ids, texts;
+            make_reviews(n, ids, texts);
+            Digest expected = reference_root(ids, texts, mode);
+
+            // Chunked, one review at a time and precomputed leaves
+            MerkleStream stream, byLeaf;
+            init_merkle_stream(stream, mode);
+            init_merkle_stream(byLeaf, mode);
+            stream_append_chunk(stream, ids.data(), texts.data(), n / 2);
+            for (size_t i = n / 2; i < n; i++) stream_append(stream, ids[i], texts[i]);
+            for (size_t i = 0; i < n; i++) stream_append_leaf(byLeaf, hash_leaf(ids[i], texts[i], mode));
+            CHECK(stream.leafCount == n);
+            CHECK(stream_root(stream) == expected);
+            CHECK(stream_root(byLeaf) == expected);
+        }
+    }
+}
+
+TEST(stream_frontier_holds_the_complete_subtree_roots) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 1000, HASH_MODE_BINARY);
+
+    MerkleStream stream;
+    init_merkle_stream(stream);
+    for (size_t n = 1; n <= ids.size(); n++) {
+        stream_append(stream, ids[n - 1], texts[n - 1]);
+
+        // Bit k of n set: frontier[k] roots the next 2^k leaves, largest first
+        size_t start = 0;
+        for (size_t k = 64; k-- > 0;) {
+            if (!((n >> k) & 1)) continue;
+            CHECK(stream.frontier[k] == node_hash(tree, k, start >> k));
+            start += (size_t)1 << k;
+        }
+
+        // The root so far is the root of the first n leaves, and the
+        // stream keeps growing afterwards
+        if (n % 97 == 0 || n == 1) {
+            MerkleTree prefix;
+            init_merkle_tree(prefix, ids.data(), texts.data(), n);
+            CHECK(stream_root(stream) == get_merkle_root(prefix));
+            free_merkle_tree(prefix);
+        }
+    }
+    CHECK(stream_root(stream) == get_merkle_root(tree));
+    free_merkle_tree(tree);
+}
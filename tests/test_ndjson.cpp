@@ -0,0 +1,235 @@
+#include "test.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <filesystem>
+#include <fstream>
+#include "json.hpp"
+#include "ndjson.h"
+#include "preprocess.h"
+
+// What a full json.hpp parse makes of the line
+static bool reference_parse(const string& line, string& id, string& text) {
+    try {
+        nlohmann::json j = nlohmann::json::parse(line);
+        if (!j.is_object() || !j.contains("reviewID") || !j.contains("reviewText")) return false;
+        if (!j["reviewID"].is_string() || !j["reviewText"].is_string()) return false;
+        id = j["reviewID"].get<string>();
+        text = j["reviewText"].get<string>();
+        return true;
+    }
+    catch (...) {
+        return false;
+    }
+}
+
+TEST(review_lines_parse_like_a_full_json_parse) {
+    struct Case {
+        string line;
+        bool found;
+        bool fellBack;
+    };
+    const vector<Case> cases = {
+        // Flat records stay on the fast scanner
+        { R"({"reviewID":"A1","reviewText":"hello"})", true, false },
+        { R"( { "overall" : 5.0, "verified": true, "reviewID" : "A2", "vote": null, "reviewText": "t", "n": -1.5e3 } )",
+            true, false },
+        { "{\"reviewID\":\"A3\",\"reviewText\":\"crlf\"}\r", true, false },
+        { R"({"reviewText":"x","reviewID":"A4","reviewText":"last wins"})", true, false },
+        { R"({"reviewID":"q\"uote","reviewText":"a\nb\\c\/d\teéf😀g"})", true, false },
+        { "{\"reviewID\":\"A5\",\"reviewText\":\"caf\xc3\xa9 \xe2\x82\xac \xf0\x9f\x98\x80\"}", true, false },
+        { R"({"reviewID":"","reviewText":""})", true, false },
+        // Missing fields are answered without json.hpp
+        { R"({"reviewID":"A6"})", false, false },
+        { R"({})", false, false },
+        { "", false, false },
+        // Nested values and escaped keys go through json.hpp
+        { R"({"reviewID":"A7","style":{"Format:":" Kindle"},"images":["a","b"],"reviewText":"nested"})", true, true },
+        { R"({"review\u0049D":"A8","reviewText":"escaped key"})", true, true },
+        // Non-string fields and malformed input are refused
+        { R"({"reviewID":5,"reviewText":"t"})", false, true },
+        { R"({"reviewID":"A9","reviewText":null})", false, true },
+        { R"({"reviewID":"A10","reviewText":"t")", false, true },
+        { R"({"reviewID":"A11","reviewText":"t"} x)", false, true },
+        { R"({"reviewID":"A12","reviewText":"bad \q escape"})", false, true },
+        { R"({"reviewID":"A13","reviewText":"lone \ud800 surrogate"})", false, true },
+        { "{\"reviewID\":\"A14\",\"reviewText\":\"bad \xff byte\"}", false, true },
+        { "{\"reviewID\":\"A15\",\"reviewText\":\"overlong \xc0\xaf\"}", false, true },
+        { "{\"reviewID\":\"A16\",\"reviewText\":\"raw\ttab\"}", false, true },
+        { R"(["reviewID","reviewText"])", false, true },
+        { "not json", false, true },
+    };
+    for (const Case& c : cases) {
+        string id = "stale", text = "stale", refId, refText;
+        bool fellBack = !c.fellBack;
+        bool found = parse_review_line(c.line, id, text, &fellBack);
+        CHECK(found == c.found);
+        CHECK(fellBack == c.fellBack);
+        CHECK(found == reference_parse(c.line, refId, refText));
+        if (found) CHECK(id == refId && text == refText);
+    }
+
+    string id, text;
+    CHECK(parse_review_line(R"({"reviewID":"q\"uote","reviewText":"é😀"})", id, text));
+    CHECK(id == "q\"uote" && text == "\xc3\xa9\xf0\x9f\x98\x80");
+}
+
+TEST(review_files_scan_in_order_with_stats) {
+    string path = temp_path("scan.json");
+    {
+        ofstream out(path, ios::binary);
+        out << R"({"reviewID":"A1","reviewText":"one"})" << "\n"
+            << "\n"
+            << R"({"reviewID":"A2","style":{"k":"v"},"reviewText":"two"})" << "\r\n"
+            << "garbage\n"
+            << R"({"reviewID":"A3"})" << "\n"
+            << R"({"reviewID":"A4","reviewText":"four"})";
+    }
+
+    // The mapping holds the file byte for byte
+    MappedFile file;
+    CHECK(map_file(path, file));
+    string contents(file.data, file.size);
+    unmap_file(file);
+    CHECK(file.data == nullptr && file.size == 0);
+    {
+        ifstream in(path, ios::binary);
+        CHECK(contents == string(istreambuf_iterator<char>(in), istreambuf_iterator<char>()));
+    }
+
+    vector<string> ids, texts;
+    NdjsonStats stats;
+    CHECK(scan_review_file(path, [&](string& id, string& text) {
+        ids.push_back(move(id));
+        texts.push_back(move(text));
+    }, &stats));
+    CHECK(ids == vector<string>({ "A1", "A2", "A4" }));
+    CHECK(texts == vector<string>({ "one", "two", "four" }));
+    CHECK(stats.lines == 6 && stats.records == 3 && stats.fallbacks == 2);
+
+    // An empty file maps to nothing; a missing one fails
+    ofstream(path, ios::binary | ios::trunc).close();
+    CHECK(map_file(path, file) && file.size == 0);
+    unmap_file(file);
+    CHECK(scan_review_file(path, [](string&, string&) {}, &stats));
+    CHECK(stats.lines == 0 && stats.records == 0);
+    CHECK(!map_file(temp_path("missing.json"), file));
+    CHECK(!scan_review_file(temp_path("missing.json"), [](string&, string&) {}));
+    filesystem::remove(path);
+}
+
+TEST(line_splits_start_at_line_boundaries) {
+    string path = temp_path("splits.json");
+    for (const string& contents : { string(""), string("no newline"), string("a\n"), string("a\nbb\n\nccc\r\nd"),
+             string(1000, 'x') + "\n" + string(3, 'y') + "\n" + string(500, 'z') }) {
+        ofstream(path, ios::binary | ios::trunc) << contents;
+        MappedFile file;
+        CHECK(map_file(path, file));
+        vector<string> expected;
+        for_each_line(file.data, file.data + file.size, [&](string_view line) { expected.emplace_back(line); });
+
+        for (size_t parts : { 1, 2, 3, 4, 5, 7, 64 }) {
+            vector<size_t> splits = split_at_lines(file, parts);
+            CHECK(splits.size() >= 2 && splits.size() <= parts + 1);
+            CHECK(splits.front() == 0 && splits.back() == file.size);
+            // Every range is non-empty (unless the file is) and starts a line
+            for (size_t k = 1; k + 1 < splits.size(); k++) {
+                CHECK(splits[k] > splits[k - 1] && splits[k] < file.size);
+                CHECK(file.data[splits[k] - 1] == '\n');
+            }
+
+            vector<string> lines;
+            for (size_t k = 0; k + 1 < splits.size(); k++)
+                for_each_line(file.data + splits[k], file.data + splits[k + 1],
+                    [&](string_view line) { lines.emplace_back(line); });
+            CHECK(lines == expected);
+        }
+        unmap_file(file);
+    }
+    filesystem::remove(path);
+}
+
+TEST(review_files_load_the_same_on_any_thread_count) {
+    vector<string> ids, texts;
+    make_reviews(9000, ids, texts);
+    string path = write_dataset("loaders.json", ids, texts);
+    {
+        // Blank, junk and fallback lines land in different parts
+        ofstream out(path, ios::binary | ios::app);
+        out << "\n\njunk\n" << R"({"reviewID":"N1","style":{"k":"v"},"reviewText":"nested"})" << "\n";
+    }
+    ids.push_back("N1");
+    texts.push_back("nested");
+
+    NdjsonStats sequential;
+    vector<string> scannedIds;
+    CHECK(scan_review_file(path, [&](string& id, string&) { scannedIds.push_back(id); }, &sequential));
+    CHECK(scannedIds == ids);
+    for (unsigned threads : { 1u, 2u, 3u, 4u, 5u, 0u }) {
+        vector<string> loadedIds = { "stale" }, loadedTexts;
+        NdjsonStats stats;
+        CHECK(load_review_file(path, loadedIds, loadedTexts, threads, &stats));
+        CHECK(loadedIds == ids);
+        CHECK(loadedTexts == texts);
+        CHECK(stats.lines == sequential.lines && stats.records == sequential.records);
+        CHECK(stats.fallbacks == sequential.fallbacks && stats.fallbacks == 2);
+    }
+
+    // More threads than lines
+    vector<string> fewIds(ids.begin(), ids.begin() + 3), fewTexts(texts.begin(), texts.begin() + 3);
+    string fewPath = write_dataset("few.json", fewIds, fewTexts);
+    vector<string> loadedIds, loadedTexts;
+    CHECK(load_review_file(fewPath, loadedIds, loadedTexts, 16));
+    CHECK(loadedIds == fewIds && loadedTexts == fewTexts);
+    CHECK(!load_review_file(temp_path("missing.json"), loadedIds, loadedTexts, 4));
+    filesystem::remove(fewPath);
+    filesystem::remove(path);
+}
+
+TEST(preprocess_loads_the_same_on_any_thread_count) {
+    // Generated IDs and duplicate fixups depend on every earlier record
+    string path = temp_path("preprocess.json");
+    {
+        ofstream out(path, ios::binary);
+        for (int i = 0; i < 400; i++) {
+            switch (i % 6) {
+            case 0: out << R"({"reviewID":"R)" << i << R"(","reviewText":"  padded  "})"; break;
+            case 1: out << R"({"reviewText":"no id"})"; break;
+            case 2: out << R"({"reviewID":"DUP","reviewText":"again"})"; break;
+            case 3: out << R"({"reviewID":"GENID_)" << i / 6 + 1 << R"(","reviewText":null})"; break;
+            case 4: out << R"({"reviewID":"R)" << i << R"(","reviewText":7})"; break;
+            default: out << "not json"; break;
+            }
+            out << "\n";
+        }
+    }
+
+    // load_reviews() reports the count on stdout
+    ostringstream quiet;
+    streambuf* saved = cout.rdbuf(quiet.rdbuf());
+    ReviewArray reference;
+    init_review_array(reference, 4);
+    load_reviews(path, reference, 1);
+    CHECK(reference.size > 200);
+    for (unsigned threads : { 2u, 3u, 4u, 5u, 0u }) {
+        ReviewArray arr;
+        init_review_array(arr, 4);
+        load_reviews(path, arr, threads);
+        CHECK(arr.size == reference.size);
+        for (size_t i = 0; i < min(arr.size, reference.size); i++) {
+            CHECK(arr.reviews[i].reviewID == reference.reviews[i].reviewID);
+            CHECK(arr.reviews[i].reviewText == reference.reviews[i].reviewText);
+        }
+        free_review_array(arr);
+    }
+    cout.rdbuf(saved);
+
+    // IDs come out unique, and texts trimmed
+    vector<string> seen;
+    for (size_t i = 0; i < reference.size; i++) seen.push_back(reference.reviews[i].reviewID);
+    sort(seen.begin(), seen.end());
+    CHECK(adjacent_find(seen.begin(), seen.end()) == seen.end());
+    CHECK(reference.reviews[0].reviewID == "R0" && reference.reviews[0].reviewText == "padded");
+    free_review_array(reference);
+    filesystem::remove(path);
+}
@@ -0,0 +1,108 @@
+#include "test.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include "pipeline.h"
+
+TEST(spsc_queue_keeps_order_and_bounds) {
+    SpscQueue<int> queue(4);
+    int item = 0;
+    CHECK(!queue.try_pop(item));
+    for (int i = 0; i < 4; i++) {
+        item = i;
+        CHECK(queue.try_push(item));
+    }
+    item = 4;
+    CHECK(!queue.try_push(item) && item == 4);
+    CHECK(queue.try_pop(item) && item == 0);
+
+    // The consumer starts first and parks on an empty queue; the producer
+    // keeps overrunning the small ring, so both sides wait in turn
+    while (queue.try_pop(item)) {}
+    const int count = 100000;
+    vector<int> received;
+    thread consumer([&] {
+        int value = 0;
+        for (int i = 0; i < count; i++) {
+            queue.pop(value);
+            received.push_back(value);
+        }
+    });
+    for (int i = 0; i < count; i++) {
+        int value = i;
+        queue.push(value);
+    }
+    consumer.join();
+    CHECK((int)received.size() == count);
+    bool inOrder = true;
+    for (int i = 0; i < count && inOrder; i++) inOrder = received[i] == i;
+    CHECK(inOrder);
+    CHECK(queue.sleepers.load() == 0);
+}
+
+TEST(pipeline_matches_the_in_memory_build) {
+    vector<string> ids, texts;
+    make_reviews(9000, ids, texts);
+    string path = write_dataset("pipeline_modes.json", ids, texts);
+
+    for (HashMode mode : ALL_HASH_MODES) {
+        Digest expected = reference_root(ids, texts, mode);
+        for (unsigned threads : { 1u, 2u, 4u }) {
+            vector<string> pipedIds, pipedTexts;
+            MerkleTree tree;
+            PipelineStats stats;
+            CHECK(load_and_build(path, pipedIds, pipedTexts, tree, mode, threads, &stats));
+            CHECK(stats.records == ids.size());
+            CHECK(pipedIds == ids);
+            CHECK(pipedTexts == texts);
+            CHECK(get_merkle_root(tree) == expected);
+
+            size_t index = 0;
+            CHECK(find_leaf_by_id(tree, ids[4321], index) && index == 4321);
+            free_merkle_tree(tree);
+        }
+    }
+
+    vector<string> none, noneTexts;
+    MerkleTree tree;
+    CHECK(!load_and_build(temp_path("missing.json"), none, noneTexts, tree));
+    filesystem::remove(path);
+}
+
+TEST(pipeline_tree_matches_init_merkle_tree_node_for_node) {
+    for (size_t n : { 1, 2, 4095, 4096, 4097, 8193, 20481 }) {
+        vector<string> ids, texts;
+        make_reviews(n, ids, texts);
+        string path = write_dataset("pipeline.json", ids, texts);
+        // Lines that are not records only make the reservation larger
+        ofstream(path, ios::app) << "\n{\"other\": 1}\nnot json\n";
+
+        MerkleTree expected;
+        init_merkle_tree(expected, ids.data(), texts.data(), n, HASH_MODE_XXH3_128);
+        for (unsigned threads : { 1u, 3u }) {
+            vector<string> pipedIds, pipedTexts;
+            MerkleTree tree;
+            PipelineStats stats;
+            CHECK(load_and_build(path, pipedIds, pipedTexts, tree, HASH_MODE_XXH3_128, threads, &stats));
+            CHECK(pipedIds == ids);
+            CHECK(tree.leafCount == n && tree.levelCount == expected.levelCount);
+            CHECK(tree.nodeCount == expected.nodeCount);
+            CHECK(equal(tree.nodes, tree.nodes + tree.nodeCount, expected.nodes));
+            CHECK(equal(tree.levelOffsets, tree.levelOffsets + tree.levelCount, expected.levelOffsets));
+            size_t index = 0;
+            CHECK(find_leaf_by_id(tree, ids[n - 1], index) && index == n - 1);
+            free_merkle_tree(tree);
+        }
+        free_merkle_tree(expected);
+        filesystem::remove(path);
+    }
+
+    string path = temp_path("no_records.json");
+    ofstream(path) << "\n\n{}\n";
+    vector<string> pipedIds, pipedTexts;
+    MerkleTree tree;
+    CHECK(load_and_build(path, pipedIds, pipedTexts, tree));
+    CHECK(pipedIds.empty() && tree.nodeCount == 0 && tree.nodes == nullptr);
+    filesystem::remove(path);
+}
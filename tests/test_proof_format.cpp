@@ -0,0 +1,129 @@
+#include "test.h"
+#include "proof_format.h"
+
+static void put_u64(vector<uint8_t>& bytes, size_t at, uint64_t value) {
+    for (int i = 0; i < 8; i++) bytes[at + i] = (uint8_t)(value >> (8 * i));
+}
+
+TEST(serialized_proofs_round_trip) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 300, HASH_MODE_BLAKE3);
+    Digest root = get_merkle_root(tree);
+
+    ProofStep proof[64];
+    size_t proofLen = 0;
+    CHECK(generate_proof_by_index(tree, 123, proof, proofLen));
+    vector<uint8_t> bytes;
+    CHECK(serialize_proof(proof, proofLen, 123, 300, HASH_MODE_BLAKE3, bytes));
+    CHECK(bytes.size() == serialized_proof_size(proofLen));
+
+    ProofView view;
+    CHECK(parse_proof(bytes.data(), bytes.size(), view));
+    CHECK(view.leafIndex == 123 && view.leafCount == 300 && view.siblings.size == proofLen);
+    Digest leaf = hash_leaf(ids[123], texts[123], HASH_MODE_BLAKE3);
+    CHECK(verify_serialized_proof(bytes.data(), bytes.size(), leaf, root, HASH_MODE_BLAKE3));
+
+    // Another mode, a truncated buffer, a bad magic, reserved bits or a
+    // tampered digest
+    CHECK(!verify_serialized_proof(bytes.data(), bytes.size(), leaf, root, HASH_MODE_BINARY));
+    CHECK(!parse_proof(bytes.data(), bytes.size() - 1, view));
+    vector<uint8_t> bad = bytes;
+    bad[0] = 'X';
+    CHECK(!parse_proof(bad.data(), bad.size(), view));
+    bad = bytes;
+    bad[7] = 1;
+    CHECK(!parse_proof(bad.data(), bad.size(), view));
+    bad = bytes;
+    bad.back() ^= 1;
+    CHECK(!verify_serialized_proof(bad.data(), bad.size(), leaf, root, HASH_MODE_BLAKE3));
+
+    // The encoded index drives the fold, so the same siblings do not verify
+    // under another index, and the index must lie inside the tree
+    for (uint64_t other : { 122, 124, 59, 0, 299 }) {
+        bad = bytes;
+        put_u64(bad, 8, other);
+        CHECK(!verify_serialized_proof(bad.data(), bad.size(), leaf, root, HASH_MODE_BLAKE3));
+    }
+    bad = bytes;
+    put_u64(bad, 8, 300);
+    CHECK(!parse_proof(bad.data(), bad.size(), view));
+    bad = bytes;
+    put_u64(bad, 16, 5);
+    CHECK(!parse_proof(bad.data(), bad.size(), view));
+
+    // Proofs that do not match the claimed position are not encoded
+    vector<uint8_t> refused;
+    CHECK(!serialize_proof(proof, proofLen, 122, 300, HASH_MODE_BLAKE3, refused));
+    CHECK(!serialize_proof(proof, proofLen, 123, 123, HASH_MODE_BLAKE3, refused));
+    CHECK(refused.empty());
+    free_merkle_tree(tree);
+}
+
+TEST(serialized_proof_shape_matches_the_tree) {
+    for (size_t n = 1; n <= 70; n++) {
+        vector<string> ids, texts;
+        MerkleTree tree;
+        make_tree(tree, ids, texts, n, HASH_MODE_XXH3_128);
+        for (size_t i = 0; i < n; i++) {
+            ProofStep proof[64];
+            size_t proofLen = 0;
+            generate_proof_by_index(tree, i, proof, proofLen);
+
+            // The derived shape is exactly the one the tree produces
+            size_t steps = 0;
+            uint64_t directions = 0, expected = 0;
+            CHECK(proof_path_shape(i, n, steps, directions));
+            for (size_t k = 0; k < proofLen; k++)
+                if (proof[k].isLeft) expected |= 1ull << k;
+            CHECK(steps == proofLen && directions == expected);
+            vector<uint8_t> bytes;
+            CHECK(serialize_proof(proof, proofLen, i, n, HASH_MODE_XXH3_128, bytes));
+            CHECK(verify_serialized_proof(bytes.data(), bytes.size(), tree.nodes[i], get_merkle_root(tree),
+                HASH_MODE_XXH3_128));
+        }
+        size_t steps = 0;
+        uint64_t directions = 0;
+        CHECK(!proof_path_shape(n, n, steps, directions));
+        free_merkle_tree(tree);
+    }
+}
+
+TEST(parsed_proofs_point_into_the_buffer) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 1000, HASH_MODE_BINARY);
+    ProofStep proof[64];
+    size_t proofLen = 0;
+    CHECK(generate_proof_by_index(tree, 600, proof, proofLen));
+
+    // serialize_proof() appends, so several proofs can share one buffer
+    vector<uint8_t> bytes = { 0xAA, 0xBB };
+    CHECK(serialize_proof(proof, proofLen, 600, 1000, HASH_MODE_BINARY, bytes));
+    CHECK(bytes.size() == 2 + serialized_proof_size(proofLen));
+    CHECK(bytes[0] == 0xAA && bytes[1] == 0xBB);
+
+    ProofView view;
+    const uint8_t* data = bytes.data() + 2;
+    CHECK(parse_proof(data, bytes.size() - 2, view));
+    CHECK((const uint8_t*)view.siblings.data == data + PROOF_HEADER_BYTES);
+    CHECK(view.mode == HASH_MODE_BINARY);
+    size_t k = 0;
+    for (const Digest& sibling : view.siblings) {
+        CHECK(sibling == proof[k].siblingHash);
+        CHECK(((view.directions >> k) & 1) == (uint64_t)proof[k].isLeft);
+        k++;
+    }
+    CHECK(k == proofLen);
+
+    // A single-leaf tree has an empty proof: the leaf is the root
+    MerkleTree single;
+    init_merkle_tree(single, ids.data(), texts.data(), 1, HASH_MODE_BINARY);
+    vector<uint8_t> empty;
+    CHECK(serialize_proof(proof, 0, 0, 1, HASH_MODE_BINARY, empty));
+    CHECK(empty.size() == PROOF_HEADER_BYTES);
+    CHECK(verify_serialized_proof(empty.data(), empty.size(), single.nodes[0], get_merkle_root(single)));
+    CHECK(!parse_proof(empty.data(), 0, view));
+    free_merkle_tree(single);
+    free_merkle_tree(tree);
+}
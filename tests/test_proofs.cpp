@@ -0,0 +1,336 @@
+#include "test.h"
+#include <algorithm>
+
+TEST(inclusion_proofs_round_trip) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        for (size_t n : { 1, 2, 3, 7, 100, 1025 }) {
+            vector<string> ids, texts;
+            MerkleTree tree;
+            make_tree(tree, ids, texts, n, mode);
+            Digest root = get_merkle_root(tree);
+            for (size_t i = 0; i < n; i += n / 17 + 1) {
+                Digest leaf = hash_leaf(ids[i], texts[i], mode);
+                ProofStep proof[64];
+                size_t proofLen = 0;
+                CHECK(generate_proof(tree, leaf, proof, proofLen));
+                CHECK(verify_proof(leaf, proof, proofLen, root, mode));
+
+                // Wrong leaf, wrong root, flipped direction, tampered sibling
+                Digest other = hash_leaf(ids[i], texts[i] + "!", mode);
+                CHECK(!verify_proof(other, proof, proofLen, root, mode));
+                Digest badRoot = root;
+                badRoot[0] ^= 1;
+                CHECK(!verify_proof(leaf, proof, proofLen, badRoot, mode));
+                if (proofLen > 0) {
+                    proof[0].isLeft = !proof[0].isLeft;
+                    CHECK(!verify_proof(leaf, proof, proofLen, root, mode));
+                    proof[0].isLeft = !proof[0].isLeft;
+                    proof[proofLen - 1].siblingHash[3] ^= 0x40;
+                    CHECK(!verify_proof(leaf, proof, proofLen, root, mode));
+                }
+            }
+            ProofStep proof[64];
+            size_t proofLen = 0;
+            CHECK(!generate_proof_by_index(tree, n, proof, proofLen));
+            free_merkle_tree(tree);
+        }
+    }
+}
+
+TEST(leaf_lookups_resolve_to_the_lowest_index) {
+    vector<string> ids, texts;
+    make_reviews(100, ids, texts);
+    ids[10] = ids[3];
+    texts[10] = texts[3]; // the same leaf twice
+    ids[20] = ids[5];     // a repeated ID with another text
+    MerkleTree tree;
+    init_merkle_tree(tree, ids.data(), texts.data(), ids.size());
+
+    size_t index = 0;
+    Digest leaf3 = hash_leaf(ids[3], texts[3]);
+    CHECK(find_leaf_by_hash(tree, leaf3, index) && index == 3);
+    CHECK(find_leaf_by_id(tree, ids[3], index) && index == 3);
+    CHECK(find_leaf_by_id(tree, ids[5], index) && index == 5);
+    CHECK(find_leaf_by_id(tree, ids[99], index) && index == 99);
+    CHECK(!find_leaf_by_id(tree, "no such review", index));
+    CHECK(!find_leaf_by_hash(tree, hash_leaf("no such", "review"), index));
+
+    ProofStep proof[64];
+    size_t proofLen = 0;
+    CHECK(generate_proof(tree, leaf3, proof, proofLen));
+    CHECK(verify_proof(leaf3, proof, proofLen, get_merkle_root(tree)));
+
+    // Updating a leaf moves both keys; the duplicate takes over the old ones
+    string oldId = ids[3];
+    CHECK(update_leaf(tree, 3, "R-new", "new text"));
+    CHECK(find_leaf_by_id(tree, "R-new", index) && index == 3);
+    CHECK(find_leaf_by_hash(tree, hash_leaf("R-new", "new text"), index) && index == 3);
+    CHECK(find_leaf_by_id(tree, oldId, index) && index == 10);
+    CHECK(find_leaf_by_hash(tree, leaf3, index) && index == 10);
+    free_merkle_tree(tree);
+}
+
+TEST(batch_verification_flags_each_proof) {
+    // Checks against two different trees, each pointing at its own root
+    vector<string> ids, texts, otherIds, otherTexts;
+    MerkleTree tree, other;
+    make_tree(tree, ids, texts, 500, HASH_MODE_BLAKE3);
+    make_reviews(77, otherIds, otherTexts);
+    init_merkle_tree(other, otherIds.data(), otherTexts.data(), otherIds.size(), HASH_MODE_BLAKE3);
+    Digest roots[2] = { get_merkle_root(tree), get_merkle_root(other) };
+
+    for (size_t count : { (size_t)1, (size_t)63, (size_t)64, (size_t)65, (size_t)130 }) {
+        vector<ProofStep> steps(count * 64);
+        vector<ProofCheck> checks(count);
+        vector<bool> expected(count);
+        for (size_t k = 0; k < count; k++) {
+            bool fromOther = k % 4 == 3;
+            size_t index = fromOther ? k % otherIds.size() : k * 3;
+            checks[k].leafHash = fromOther ? hash_leaf(otherIds[index], otherTexts[index], HASH_MODE_BLAKE3)
+                : hash_leaf(ids[index], texts[index], HASH_MODE_BLAKE3);
+            checks[k].proof = &steps[k * 64];
+            checks[k].rootHash = &roots[fromOther];
+            generate_proof_by_index(fromOther ? other : tree, index, &steps[k * 64], checks[k].proofLen);
+            if (k % 9 == 4) checks[k].leafHash[0] ^= 1;
+            if (k % 13 == 6) checks[k].rootHash = &roots[!fromOther];
+            expected[k] = verify_proof(checks[k].leafHash, &steps[k * 64], checks[k].proofLen, *checks[k].rootHash,
+                HASH_MODE_BLAKE3);
+            CHECK(expected[k] == (k % 9 != 4 && k % 13 != 6));
+        }
+        for (unsigned threads : { 1u, 3u, 0u }) {
+            vector<uint64_t> bits((count + 63) / 64, ~(uint64_t)0);
+            size_t passed = verify_proofs_batch(checks.data(), count, bits.data(), HASH_MODE_BLAKE3, threads);
+            size_t expectedPassed = 0;
+            for (size_t k = 0; k < count; k++) {
+                CHECK((((bits[k / 64] >> (k % 64)) & 1) != 0) == expected[k]);
+                expectedPassed += expected[k];
+            }
+            // Bits past the last check are cleared
+            if (count % 64) CHECK(bits.back() >> (count % 64) == 0);
+            CHECK(passed == expectedPassed);
+        }
+    }
+    CHECK(verify_proofs_batch(nullptr, 0, nullptr, HASH_MODE_BLAKE3) == 0);
+    free_merkle_tree(other);
+    free_merkle_tree(tree);
+}
+
+TEST(multiproofs_round_trip) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        MerkleTree tree;
+        make_tree(tree, ids, texts, 333, mode);
+        Digest root = get_merkle_root(tree);
+
+        // Unsorted, with a repeat; the proof keeps them sorted and unique
+        vector<size_t> indices = { 250, 0, 1, 2, 17, 100, 101, 332, 17 };
+        MultiProof proof;
+        CHECK(generate_multiproof(tree, indices.data(), indices.size(), proof));
+        CHECK(proof.indices == (vector<size_t>{ 0, 1, 2, 17, 100, 101, 250, 332 }));
+        vector<Digest> leaves;
+        for (size_t index : proof.indices) leaves.push_back(hash_leaf(ids[index], texts[index], mode));
+        size_t hashes = 0;
+        CHECK(verify_multiproof(proof, leaves.data(), root, mode, &hashes));
+        CHECK(hashes > 0);
+
+        leaves[3][0] ^= 1;
+        CHECK(!verify_multiproof(proof, leaves.data(), root, mode));
+        leaves[3][0] ^= 1;
+        MultiProof shortened = proof;
+        shortened.siblings.pop_back();
+        CHECK(!verify_multiproof(shortened, leaves.data(), root, mode));
+        MultiProof lengthened = proof;
+        lengthened.siblings.push_back(root);
+        CHECK(!verify_multiproof(lengthened, leaves.data(), root, mode));
+
+        size_t outOfRange = 333;
+        CHECK(!generate_multiproof(tree, &outOfRange, 1, proof));
+        free_merkle_tree(tree);
+    }
+}
+
+TEST(multiproofs_share_sibling_digests) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 1000, HASH_MODE_BINARY);
+    auto single_proofs_length = [&](const vector<size_t>& indices) {
+        size_t total = 0;
+        for (size_t index : indices) {
+            ProofStep proof[64];
+            size_t proofLen = 0;
+            generate_proof_by_index(tree, index, proof, proofLen);
+            total += proofLen;
+        }
+        return total;
+    };
+
+    // Two siblings need one digest fewer than a single proof, since each
+    // stands in for the other
+    MultiProof proof;
+    vector<size_t> pair = { 40, 41 };
+    CHECK(generate_multiproof(tree, pair.data(), pair.size(), proof));
+    CHECK(proof.siblings.size() == single_proofs_length({ 40 }) - 1);
+
+    // A clustered set costs far less than its separate proofs
+    vector<size_t> cluster;
+    for (size_t i = 256; i < 320; i += 3) cluster.push_back(i);
+    CHECK(generate_multiproof(tree, cluster.data(), cluster.size(), proof));
+    CHECK(proof.siblings.size() * 3 < single_proofs_length(cluster));
+
+    // Every leaf: nothing is left to supply
+    vector<size_t> all(ids.size());
+    for (size_t i = 0; i < all.size(); i++) all[i] = i;
+    CHECK(generate_multiproof(tree, all.data(), all.size(), proof));
+    CHECK(proof.siblings.empty());
+    vector<Digest> leaves(tree.nodes, tree.nodes + tree.leafCount);
+    CHECK(verify_multiproof(proof, leaves.data(), get_merkle_root(tree)));
+    free_merkle_tree(tree);
+}
+
+TEST(single_leaf_updates_match_a_rebuild) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        MerkleTree tree;
+        make_tree(tree, ids, texts, 301, mode);
+
+        // First, middle, the promoted last leaf, one ID change and a repeat
+        vector<pair<size_t, string>> edits = { { 0, "first" }, { 150, "middle" }, { 300, "changed last" },
+            { 77, "new id" }, { 150, "middle again" } };
+        for (const auto& edit : edits) {
+            if (edit.first == 77) ids[77] = "R-renamed";
+            texts[edit.first] = edit.second;
+            CHECK(update_leaf(tree, edit.first, ids[edit.first], edit.second));
+
+            MerkleTree rebuilt;
+            init_merkle_tree(rebuilt, ids.data(), texts.data(), ids.size(), mode);
+            CHECK(equal(tree.nodes, tree.nodes + tree.nodeCount, rebuilt.nodes));
+            free_merkle_tree(rebuilt);
+        }
+        size_t index = 0;
+        CHECK(find_leaf_by_id(tree, "R-renamed", index) && index == 77);
+
+        Digest root = get_merkle_root(tree);
+        CHECK(!update_leaf(tree, 301, ids[0], "out of range"));
+        CHECK(get_merkle_root(tree) == root);
+        free_merkle_tree(tree);
+    }
+}
+
+TEST(batched_updates_match_a_rebuild) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        // Siblings 4 and 5 share every ancestor, 5 is repeated (the later
+        // text wins) and 9999 is out of range
+        vector<pair<size_t, string>> updates = { { 5, "a" }, { 4, "b" }, { 150, "c" }, { 5, "d" }, { 9999, "skipped" },
+            { 300, "e" } };
+        for (unsigned threads : { 1u, 3u }) {
+            vector<string> ids, texts;
+            MerkleTree tree;
+            make_tree(tree, ids, texts, 301, mode);
+            UpdateStats stats = apply_updates(tree, updates.data(), updates.size(), threads);
+            texts[4] = "b";
+            texts[5] = "d";
+            texts[150] = "c";
+            texts[300] = "e";
+
+            CHECK(stats.leavesUpdated == 5);
+            CHECK(stats.hashesComputed < stats.sequentialHashes);
+            MerkleTree rebuilt;
+            init_merkle_tree(rebuilt, ids.data(), texts.data(), ids.size(), mode);
+            CHECK(equal(tree.nodes, tree.nodes + tree.nodeCount, rebuilt.nodes));
+            size_t index = 0;
+            CHECK(find_leaf_by_hash(tree, hash_leaf(ids[5], "d", mode), index) && index == 5);
+            free_merkle_tree(rebuilt);
+            free_merkle_tree(tree);
+        }
+    }
+
+    // Enough dirty nodes per level for the level passes to be split
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 20000, HASH_MODE_BLAKE3);
+    vector<pair<size_t, string>> updates;
+    for (size_t i = 0; i < ids.size(); i += 2) {
+        texts[i] += " edited";
+        updates.push_back({ i, texts[i] });
+    }
+    UpdateStats stats = apply_updates(tree, updates.data(), updates.size(), 3);
+    CHECK(stats.leavesUpdated == updates.size());
+    MerkleTree rebuilt;
+    init_merkle_tree(rebuilt, ids.data(), texts.data(), ids.size(), HASH_MODE_BLAKE3);
+    CHECK(equal(tree.nodes, tree.nodes + tree.nodeCount, rebuilt.nodes));
+    free_merkle_tree(rebuilt);
+    free_merkle_tree(tree);
+}
+
+TEST(diff_trees_reports_the_changed_leaves) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        MerkleTree tree, same, tampered;
+        make_tree(tree, ids, texts, 301, mode);
+
+        // Identical trees stop at the root
+        init_merkle_tree(same, ids.data(), texts.data(), ids.size(), mode);
+        vector<size_t> differing = { 1 };
+        size_t compared = 0;
+        CHECK(diff_trees(tree, same, differing, &compared));
+        CHECK(differing.empty() && compared == 1);
+
+        // Neighbours, the odd leaf promoted up the right edge, and one far away
+        vector<size_t> changed = { 76, 77, 150, 300 };
+        for (size_t index : changed) texts[index] = "tampered";
+        init_merkle_tree(tampered, ids.data(), texts.data(), ids.size(), mode);
+        CHECK(diff_trees(tree, tampered, differing, &compared));
+        CHECK(differing == changed);
+        CHECK(compared <= 1 + 2 * changed.size() * (tree.levelCount - 1));
+        CHECK(diff_trees(tampered, tree, differing) && differing == changed);
+        free_merkle_tree(tampered);
+        free_merkle_tree(same);
+        free_merkle_tree(tree);
+    }
+}
+
+TEST(diff_trees_refuses_mismatched_trees) {
+    vector<string> ids, texts;
+    MerkleTree tree, shorter, otherMode;
+    make_tree(tree, ids, texts, 64, HASH_MODE_BINARY);
+    init_merkle_tree(shorter, ids.data(), texts.data(), 63, HASH_MODE_BINARY);
+    init_merkle_tree(otherMode, ids.data(), texts.data(), 64, HASH_MODE_BLAKE3);
+    vector<size_t> differing = { 5 };
+    CHECK(!diff_trees(tree, shorter, differing) && differing.empty());
+    CHECK(!diff_trees(tree, otherMode, differing) && differing.empty());
+
+    MerkleTree empty, alsoEmpty;
+    size_t compared = 9;
+    CHECK(diff_trees(empty, alsoEmpty, differing, &compared) && differing.empty() && compared == 0);
+    free_merkle_tree(otherMode);
+    free_merkle_tree(shorter);
+    free_merkle_tree(tree);
+}
+
+TEST(diff_finds_the_leaves_patched_into_a_copy) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 5000, HASH_MODE_BINARY);
+
+    // The tampering demo: patch a node-only copy, then diff it against the original
+    MerkleTree forged;
+    copy_tree_nodes(tree, forged);
+    CHECK(get_merkle_root(forged) == get_merkle_root(tree));
+    CHECK(forged.leafIndex.empty() && forged.idIndex.empty());
+    forged.leafIds.resize(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) forged.leafIds[i] = &ids[i];
+
+    vector<size_t> tampered = { 0, 1, 2047, 2048, 4999 };
+    vector<pair<size_t, string>> edits;
+    for (size_t index : tampered) edits.push_back({ index, texts[index] + " [tampered]" });
+    UpdateStats stats = apply_updates(forged, edits.data(), edits.size());
+    CHECK(stats.hashesComputed <= tampered.size() * forged.levelCount);
+
+    vector<size_t> changed;
+    size_t compared = 0;
+    CHECK(diff_trees(tree, forged, changed, &compared));
+    CHECK(changed == tampered);
+    CHECK(compared <= 2 * tampered.size() * tree.levelCount);
+    free_merkle_tree(forged);
+    free_merkle_tree(tree);
+}
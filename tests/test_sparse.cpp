@@ -0,0 +1,85 @@
+#include "test.h"
+#include "sparse_merkle.h"
+
+TEST(sparse_root_is_independent_of_insertion_order) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        make_reviews(300, ids, texts);
+        SparseMerkleTree bulk, inserted;
+        build_sparse_tree(bulk, ids.data(), texts.data(), ids.size(), mode, 2);
+        init_sparse_tree(inserted, mode);
+        for (size_t i = ids.size(); i-- > 0;) sparse_insert(inserted, ids[i], texts[i]);
+        CHECK(sparse_root(bulk) == sparse_root(inserted));
+
+        // Replacing a text changes the root; restoring it brings it back
+        Digest before = sparse_root(inserted);
+        sparse_insert(inserted, ids[10], "changed");
+        CHECK(sparse_root(inserted) != before);
+        sparse_insert(inserted, ids[10], texts[10]);
+        CHECK(sparse_root(inserted) == before);
+
+        SparseMerkleTree empty;
+        init_sparse_tree(empty, mode);
+        CHECK(sparse_root(empty) == sparse_empty_digests(mode)[0]);
+    }
+}
+
+TEST(sparse_membership_and_absence_proofs) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        make_reviews(200, ids, texts);
+        SparseMerkleTree tree;
+        build_sparse_tree(tree, ids.data(), texts.data(), ids.size(), mode);
+        Digest root = sparse_root(tree);
+
+        for (size_t i = 0; i < ids.size(); i += 7) {
+            SparseProof proof;
+            CHECK(generate_sparse_proof(tree, ids[i], proof));
+            Digest value = hash_leaf(ids[i], texts[i], mode);
+            CHECK(verify_sparse_membership(root, ids[i], value, proof, mode));
+            CHECK(!verify_sparse_absence(root, ids[i], proof, mode));
+            CHECK(!verify_sparse_membership(root, ids[i], hash_leaf(ids[i], "other", mode), proof, mode));
+        }
+        for (size_t k = 0; k < 50; k++) {
+            string missing = "missing-" + to_string(k);
+            SparseProof proof;
+            CHECK(!generate_sparse_proof(tree, missing, proof));
+            CHECK(verify_sparse_absence(root, missing, proof, mode));
+            // The same proof does not clear some other ID
+            CHECK(!verify_sparse_absence(root, ids[k], proof, mode));
+        }
+    }
+}
+
+// A leaf's (key, value) used to hash exactly like a branch's two children,
+// so a "leaf" at depth 0 made of the root's children folded to the root
+// and passed as an absence proof for every ID
+TEST(sparse_absence_proof_cannot_reuse_the_root_children) {
+    for (HashMode mode : ALL_HASH_MODES) {
+        vector<string> ids, texts;
+        make_reviews(200, ids, texts);
+        SparseMerkleTree tree;
+        build_sparse_tree(tree, ids.data(), texts.data(), ids.size(), mode);
+        Digest root = sparse_root(tree);
+
+        // The first sibling of a proof is the root's other child
+        Digest children[2];
+        bool found[2] = { false, false };
+        for (size_t i = 0; i < ids.size(); i++) {
+            int side = sparse_key(ids[i])[0] >> 7;
+            SparseProof proof;
+            generate_sparse_proof(tree, ids[i], proof);
+            if (found[1 - side] || !(proof.nonEmpty[0] & 1)) continue;
+            children[1 - side] = proof.siblings[0];
+            found[1 - side] = true;
+        }
+        CHECK(found[0] && found[1]);
+
+        SparseProof forged;
+        forged.depth = 0;
+        forged.terminalLeaf = true;
+        forged.leafKey = children[0];
+        forged.leafValue = children[1];
+        for (const string& id : ids) CHECK(!verify_sparse_absence(root, id, forged, mode));
+    }
+}
@@ -0,0 +1,120 @@
+#include "test.h"
+#include <algorithm>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include "tree_image.h"
+
+TEST(tree_image_round_trip) {
+    vector<string> ids, texts;
+    make_reviews(1000, ids, texts);
+    string path = temp_path("tree.img");
+    for (HashMode mode : ALL_HASH_MODES) {
+        MerkleTree built, opened;
+        init_merkle_tree(built, ids.data(), texts.data(), ids.size(), mode);
+        CHECK(save_tree_image(built, path));
+        CHECK(open_tree_image(path, opened));
+        CHECK(opened.mode == mode);
+        CHECK(opened.leafCount == built.leafCount && opened.levelCount == built.levelCount);
+        CHECK(equal(opened.levelOffsets, opened.levelOffsets + opened.levelCount, built.levelOffsets));
+        CHECK(equal(opened.nodes, opened.nodes + opened.nodeCount, built.nodes));
+
+        // The nodes are read straight from the page-aligned mapping
+        const uint8_t* image = (const uint8_t*)opened.image;
+        CHECK(image != nullptr);
+        CHECK((const uint8_t*)opened.nodes >= image);
+        CHECK((const uint8_t*)(opened.nodes + opened.nodeCount) <= image + opened.imageBytes);
+        CHECK(((const uint8_t*)opened.nodes - image) % TREE_IMAGE_ALIGN == 0);
+
+        ProofStep proof[64];
+        size_t proofLen = 0;
+        CHECK(generate_proof_by_index(opened, 777, proof, proofLen));
+        CHECK(verify_proof(hash_leaf(ids[777], texts[777], mode), proof, proofLen, get_merkle_root(built), mode));
+        vector<size_t> differing;
+        CHECK(diff_trees(built, opened, differing) && differing.empty());
+        free_merkle_tree(opened);
+        CHECK(opened.image == nullptr && opened.nodes == nullptr);
+        free_merkle_tree(built);
+    }
+    filesystem::remove(path);
+}
+
+TEST(tree_image_refuses_damaged_files) {
+    vector<string> ids, texts;
+    MerkleTree built, opened;
+    make_tree(built, ids, texts, 300, HASH_MODE_BINARY);
+    string path = temp_path("damaged.img");
+    CHECK(!open_tree_image(path + ".missing", opened));
+
+    // Save a fresh image, overwrite one byte and try to open it
+    auto opens_patched = [&](size_t at, uint8_t value) {
+        CHECK(save_tree_image(built, path));
+        {
+            fstream file(path, ios::in | ios::out | ios::binary);
+            file.seekp((streamoff)at);
+            file.put((char)value);
+        }
+        bool ok = open_tree_image(path, opened);
+        free_merkle_tree(opened);
+        return ok;
+    };
+    size_t nodesOffset = (sizeof(TreeImageHeader) + TREE_IMAGE_ALIGN - 1) / TREE_IMAGE_ALIGN * TREE_IMAGE_ALIGN;
+    CHECK(!opens_patched(offsetof(TreeImageHeader, magic), 'X'));
+    CHECK(!opens_patched(offsetof(TreeImageHeader, version), 9));
+    CHECK(!opens_patched(offsetof(TreeImageHeader, hashMode), 0xEE));
+    CHECK(!opens_patched(offsetof(TreeImageHeader, layout), 7));
+    CHECK(!opens_patched(offsetof(TreeImageHeader, leafCount), 0xFF));
+    CHECK(!opens_patched(offsetof(TreeImageHeader, levelOffsets) + sizeof(uint64_t), 0xFF));
+    // The stored root must be the last node
+    CHECK(!opens_patched(nodesOffset + (built.nodeCount - 1) * sizeof(Digest), 0x5A ^ built.nodes[built.nodeCount - 1][0]));
+    // A changed leaf still opens: the image is trusted below the root
+    CHECK(opens_patched(nodesOffset, built.nodes[0][0]));
+
+    CHECK(save_tree_image(built, path));
+    filesystem::resize_file(path, nodesOffset + (built.nodeCount - 1) * sizeof(Digest));
+    CHECK(!open_tree_image(path, opened));
+    filesystem::resize_file(path, 100);
+    CHECK(!open_tree_image(path, opened));
+
+    MerkleTree empty;
+    CHECK(!save_tree_image(empty, path));
+    free_merkle_tree(built);
+    filesystem::remove(path);
+}
+
+TEST(opened_images_have_no_lookup_indexes) {
+    vector<string> ids, texts;
+    MerkleTree built, opened;
+    make_tree(built, ids, texts, 64, HASH_MODE_XXH3_128);
+    string path = temp_path("noindex.img");
+    CHECK(save_tree_image(built, path));
+    CHECK(open_tree_image(path, opened));
+    CHECK(opened.leafIndex.empty());
+
+    // Lookups by hash miss, and batched edits that need the leaf IDs leave
+    // the tree alone
+    ProofStep proof[64];
+    size_t proofLen = 0, index = 0;
+    CHECK(!find_leaf_by_hash(opened, built.nodes[3], index));
+    CHECK(!generate_proof(opened, built.nodes[3], proof, proofLen));
+    Digest root = get_merkle_root(opened);
+    pair<size_t, string> edit(3, "changed");
+    CHECK(apply_updates(opened, &edit, 1).leavesUpdated == 0);
+    CHECK(get_merkle_root(opened) == root);
+
+    // A single-leaf edit lands on a copied page and matches the same edit
+    // on the built tree
+    CHECK(update_leaf(opened, 3, ids[3], "changed"));
+    CHECK(update_leaf(built, 3, ids[3], "changed"));
+    CHECK(get_merkle_root(opened) == get_merkle_root(built));
+    CHECK(get_merkle_root(opened) != root);
+
+    // The mapping is private: the file on disk is never written through it
+    MerkleTree again;
+    CHECK(open_tree_image(path, again));
+    CHECK(get_merkle_root(again) == root);
+    free_merkle_tree(again);
+    free_merkle_tree(opened);
+    free_merkle_tree(built);
+    filesystem::remove(path);
+}
@@ -0,0 +1,163 @@
+#include "test.h"
+#include <filesystem>
+#include "tree_image.h"
+#include "tree_versions.h"
+
+// Every leaf of a version proves against that version's recorded root
+static bool version_proves_leaves(const VersionStore& store, uint64_t id, const vector<Digest>& leaves) {
+    const TreeVersion* version = find_version(store, id);
+    if (!version) return false;
+    for (size_t i = 0; i < leaves.size(); i++) {
+        ProofStep proof[64];
+        size_t proofLen = 0;
+        if (version_leaf(store, id, i) != leaves[i]) return false;
+        if (!version_generate_proof(store, id, i, proof, proofLen)) return false;
+        if (!verify_proof(leaves[i], proof, proofLen, version->rootHash, store.mode)) return false;
+    }
+    return true;
+}
+
+TEST(versions_share_and_prove) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 77, HASH_MODE_BINARY);
+
+    // The history points at the tree instead of copying it
+    VersionStore store;
+    init_version_store(store, tree);
+    CHECK(store.baseNodes == tree.nodes);
+    CHECK(version_store_memory_bytes(store) < 1024);
+
+    vector<vector<Digest>> history;
+    auto snapshot = [&]() {
+        history.emplace_back(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) history.back()[i] = hash_leaf(ids[i], texts[i]);
+    };
+    snapshot();
+
+    // Edits that overlap earlier ones, several per version, one repeated
+    vector<vector<pair<size_t, string>>> edits = {
+        { { 42, "a" } }, { { 42, "b" }, { 43, "c" } }, { { 0, "d" }, { 76, "e" }, { 0, "f" } }, { { 40, "g" } } };
+    for (const auto& batch : edits) {
+        uint64_t id = 0;
+        CHECK(commit_version(store, tree, batch.data(), batch.size(), id));
+        CHECK(id == store.headId);
+        for (const auto& edit : batch) texts[edit.first] = edit.second;
+        snapshot();
+
+        // The head is the live tree, and every version still proves its leaves
+        CHECK(find_version(store, id)->rootHash == get_merkle_root(tree));
+        for (uint64_t v = 0; v <= id; v++) CHECK(version_proves_leaves(store, v, history[v]));
+    }
+
+    pair<size_t, string> outOfRange(77, "x");
+    uint64_t id = 0;
+    CHECK(!commit_version(store, tree, &outOfRange, 1, id));
+
+    // The head cannot be released; after releasing it the next edit used
+    // to be committed on an older version and lose the previous one
+    CHECK(!release_version(store, store.headId));
+    CHECK(release_version(store, 2));
+    CHECK(find_version(store, 2) == nullptr);
+    pair<size_t, string> change(5, "h");
+    CHECK(commit_version(store, tree, &change, 1, id));
+    texts[5] = "h";
+    snapshot();
+    CHECK(find_version(store, id)->rootHash == get_merkle_root(tree));
+    CHECK(version_proves_leaves(store, id, history.back()));
+    CHECK(version_proves_leaves(store, 4, history[4]));
+    CHECK(version_proves_leaves(store, 0, history[0]));
+
+    // Releasing every older version leaves no overlay behind
+    for (uint64_t v = 0; v < id; v++) release_version(store, v);
+    CHECK(store.liveNodes == 0);
+    CHECK(version_proves_leaves(store, id, history.back()));
+    free_version_store(store);
+    free_merkle_tree(tree);
+}
+
+TEST(versions_survive_random_edits_and_releases) {
+    vector<string> ids, texts;
+    MerkleTree tree;
+    make_tree(tree, ids, texts, 53, HASH_MODE_BLAKE3);
+    VersionStore store;
+    init_version_store(store, tree);
+
+    vector<vector<Digest>> history(1, vector<Digest>(ids.size()));
+    for (size_t i = 0; i < ids.size(); i++) history[0][i] = hash_leaf(ids[i], texts[i], HASH_MODE_BLAKE3);
+    vector<bool> released(1, false);
+
+    uint32_t seed = 12345;
+    auto next = [&]() { return seed = seed * 1103515245 + 12345, (seed >> 8) % 1000; };
+    for (int round = 0; round < 60; round++) {
+        vector<pair<size_t, string>> batch(next() % 4 + 1);
+        for (auto& edit : batch) edit = { next() % ids.size(), "r" + to_string(round) + "-" + to_string(next()) };
+        uint64_t id = 0;
+        CHECK(commit_version(store, tree, batch.data(), batch.size(), id));
+        for (const auto& edit : batch) texts[edit.first] = edit.second;
+        history.emplace_back(ids.size());
+        for (size_t i = 0; i < ids.size(); i++) history.back()[i] = hash_leaf(ids[i], texts[i], HASH_MODE_BLAKE3);
+        released.push_back(false);
+
+        uint64_t victim = next() % history.size();
+        if (next() % 3 == 0 && victim != store.headId) {
+            CHECK(release_version(store, victim) != released[victim]);
+            released[victim] = true;
+        }
+    }
+    for (uint64_t v = 0; v < history.size(); v++)
+        if (!released[v]) CHECK(version_proves_leaves(store, v, history[v]));
+    free_version_store(store);
+    free_merkle_tree(tree);
+}
+
+TEST(versions_refuse_other_trees_and_images) {
+    vector<string> ids, texts;
+    MerkleTree tree, other;
+    make_tree(tree, ids, texts, 20, HASH_MODE_BINARY);
+    make_tree(other, ids, texts, 20, HASH_MODE_BINARY);
+    VersionStore store;
+    init_version_store(store, tree);
+    CHECK(latest_version(store)->id == 0);
+    CHECK(find_version(store, 1) == nullptr);
+
+    // A failed commit leaves both the store and the tree as they were
+    Digest root = get_merkle_root(tree);
+    pair<size_t, string> change(7, "x");
+    uint64_t id = 99;
+    CHECK(!commit_version(store, other, &change, 1, id));
+    CHECK(store.versions.size() == 1 && get_merkle_root(other) == root);
+    CHECK(!release_version(store, 5));
+
+    // A history over an opened image can be read but not extended
+    string path = temp_path("versions.img");
+    MerkleTree opened;
+    CHECK(save_tree_image(tree, path));
+    CHECK(open_tree_image(path, opened));
+    VersionStore imageStore;
+    init_version_store(imageStore, opened);
+    CHECK(!commit_version(imageStore, opened, &change, 1, id));
+    ProofStep proof[64];
+    size_t proofLen = 0;
+    CHECK(version_generate_proof(imageStore, 0, 7, proof, proofLen));
+    CHECK(verify_proof(tree.nodes[7], proof, proofLen, root));
+    CHECK(!version_generate_proof(imageStore, 0, 20, proof, proofLen));
+    free_version_store(imageStore);
+    free_merkle_tree(opened);
+    filesystem::remove(path);
+
+    // Reclaimed overlay nodes are reused instead of growing the arena
+    CHECK(commit_version(store, tree, &change, 1, id));
+    CHECK(latest_version(store)->id == id);
+    size_t nodesAfterOne = store.liveNodes;
+    for (int round = 0; round < 20; round++) {
+        uint64_t previous = id;
+        change.second = "y" + to_string(round);
+        CHECK(commit_version(store, tree, &change, 1, id));
+        CHECK(release_version(store, previous));
+    }
+    CHECK(store.liveNodes == nodesAfterOne);
+    free_version_store(store);
+    free_merkle_tree(other);
+    free_merkle_tree(tree);
+}